@@ -3,8 +3,14 @@
 
 #include <cstring>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
 #include <string_view>
 #include <libsdb/types.hpp>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 
 namespace sdb {
     template <class To>
@@ -49,6 +55,91 @@ namespace sdb {
     inline std::string_view to_string_view(const std::vector<std::byte>& data) {
         return to_string_view(data.data(), data.size());
     }
+
+    namespace detail {
+        // decodes a LEB128 value of up to 8 bytes with a single load,
+        // returning it and its width in bits. longer values, and ones
+        // too close to the end of the data, take the byte-wise path
+        inline std::optional<std::pair<std::uint64_t, int>> leb128_fast_path(
+            const std::byte*& pos, const std::byte* end) {
+            if (end - pos < 8) return std::nullopt;
+
+            auto word = from_bytes<std::uint64_t>(pos);
+            auto terminators = ~word & 0x8080808080808080ull;
+            if (terminators == 0) return std::nullopt;
+
+            auto n_bytes = __builtin_ctzll(terminators) / 8 + 1;
+            if (n_bytes < 8) word &= (std::uint64_t(1) << (n_bytes * 8)) - 1;
+            pos += n_bytes;
+
+#ifdef __BMI2__
+            auto res = _pext_u64(word, 0x7f7f7f7f7f7f7f7full);
+#else
+            // squeeze the 7 bit groups together, doubling their width each step
+            auto res = word & 0x7f7f7f7f7f7f7f7full;
+            res = (res & 0x007f007f007f007full) | ((res & 0x7f007f007f007f00ull) >> 1);
+            res = (res & 0x00003fff00003fffull) | ((res & 0x3fff00003fff0000ull) >> 2);
+            res = (res & 0x000000000fffffffull) | ((res & 0x0fffffff00000000ull) >> 4);
+#endif
+            return std::pair{ res, n_bytes * 7 };
+        }
+    }
+
+    // reads the LEB128 value at pos and moves pos past it. end is where
+    // the data stops, which decides whether the fast path may be used
+    inline std::uint64_t decode_uleb128(const std::byte*& pos, const std::byte* end) {
+        auto first = static_cast<std::uint8_t>(*pos);
+        if (first < 0x80) {
+            ++pos;
+            return first;
+        }
+        if (auto fast = detail::leb128_fast_path(pos, end); fast) {
+            return fast->first;
+        }
+
+        std::uint64_t res = 0;
+        int shift = 0;
+        std::uint8_t byte = 0;
+        do {
+            byte = static_cast<std::uint8_t>(*pos++);
+            auto masked = static_cast<uint64_t>(byte & 0x7f);
+            res |= masked << shift;
+            shift += 7;
+        } while ((byte & 0x80) != 0);
+        return res;
+    }
+
+    inline std::int64_t decode_sleb128(const std::byte*& pos, const std::byte* end) {
+        auto first = static_cast<std::uint8_t>(*pos);
+        if (first < 0x80) {
+            ++pos;
+            // sign extend from bit 6
+            return static_cast<std::int8_t>(first << 1) >> 1;
+        }
+        if (auto fast = detail::leb128_fast_path(pos, end); fast) {
+            auto [res, shift] = *fast;
+            if (shift < 64 and (res >> (shift - 1)) & 1) {
+                res |= ~static_cast<std::uint64_t>(0) << shift;
+            }
+            return res;
+        }
+
+        std::uint64_t res = 0;
+        int shift = 0;
+        std::uint8_t byte = 0;
+        do {
+            byte = static_cast<std::uint8_t>(*pos++);
+            auto masked = static_cast<uint64_t>(byte & 0x7f);
+            res |= masked << shift;
+            shift += 7;
+        } while ((byte & 0x80) != 0);
+
+        if (shift < 64 and (byte & 0x40)) {
+            res |= (~static_cast<std::uint64_t>(0) << shift);
+        }
+
+        return res;
+    }
 }
 
 
@@ -568,4 +568,13 @@ enum {
     DW_EH_PE_indirect = 0x80,
 };
 
+/* From DWARF 5, used by .debug_names */
+enum {
+    DW_IDX_compile_unit = 1,
+    DW_IDX_type_unit = 2,
+    DW_IDX_die_offset = 3,
+    DW_IDX_parent = 4,
+    DW_IDX_type_hash = 5,
+};
+
 #endif
@@ -6,12 +6,22 @@
 
 namespace sdb {
     class disassembler {
+    public:
+        // ways an instruction can send the pc somewhere other than the
+        // instruction after it
+        enum class branch_kind {
+            none, jump, conditional_jump, call, ret, other
+        };
+
         struct instruction {
             virt_addr address;
             std::string text;
+            std::size_t length = 0;
+            branch_kind branch = branch_kind::none;
+            // destination of direct jumps and calls
+            std::optional<virt_addr> target;
         };
 
-    public:
         disassembler(process& proc) : process_(&proc) {}
 
         std::vector<instruction> disassemble(
@@ -19,6 +29,9 @@ namespace sdb {
             std::optional<virt_addr> address = std::nullopt
         );
 
+        // every instruction in [low, high)
+        std::vector<instruction> disassemble_range(virt_addr low, virt_addr high);
+
     private:
         process* process_;
     };
@@ -4,19 +4,26 @@
 #include <libsdb/detail/dwarf.h>
 #include <libsdb/types.hpp>
 #include <libsdb/registers.hpp>
+#include <libsdb/range_index.hpp>
 #include <unordered_map>
 #include <vector>
+#include <array>
 #include <cstdint>
 #include <memory>
 #include <string_view>
 #include <optional>
 #include <string>
 #include <filesystem>
+#include <mutex>
+#include <future>
+#include <atomic>
 
 namespace sdb {
 	class compile_unit;
 	class die;
 	class dwarf;
+	class name_index;
+	class memory_snapshot;
 
 	class call_frame_information {
 	public:
@@ -44,6 +51,43 @@ namespace sdb {
 			std::uint8_t encoding;
 			call_frame_information* parent;
 			const std::byte* operator[](file_addr address) const;
+
+			// index of the search table entry covering address
+			std::size_t find(file_addr address) const;
+			std::uint64_t address_at(std::size_t index) const;
+			const std::byte* fde_at(std::size_t index) const;
+		};
+
+		// how to recover a register in the caller's frame
+		struct register_rule {
+			enum class kind : std::uint8_t {
+				same, undefined, offset, val_offset, reg
+			};
+			kind type = kind::same;
+			// offset from the CFA, or the register holding the value
+			std::int32_t value = 0;
+		};
+
+		// rules for the general purpose registers and the return address,
+		// which are the only ones x86-64 CFI describes in practice
+		static constexpr std::size_t n_unwind_registers = 17;
+
+		// rules in effect from location until the next row's location
+		struct unwind_row {
+			std::uint64_t location;
+			std::uint32_t cfa_register;
+			std::int64_t cfa_offset;
+			// DW_CFA_def_cfa_expression, which replaces the register and
+			// offset when set. points into the section the FDE is in
+			span<const std::byte> cfa_expression;
+			std::array<register_rule, n_unwind_registers> rules;
+		};
+
+		// the CIE and FDE instructions of one FDE run once into rows
+		struct unwind_plan {
+			std::uint64_t low;
+			std::uint64_t high;
+			std::vector<unwind_row> rows;
 		};
 
 		call_frame_information() = delete;
@@ -64,11 +108,49 @@ namespace sdb {
 			file_addr pc,
 			registers& regs
 		) const;
+
+		// same, but reads saved registers from a copy of the stack
+		registers unwind(
+			memory_snapshot& stack,
+			file_addr pc,
+			registers& regs
+		) const;
+
+		// FDE found by walking .debug_frame, or .eh_frame when it has
+		// no .eh_frame_hdr to search
+		struct fde_table_entry {
+			std::uint64_t low;
+			const std::byte* fde;
+			bool debug_frame;
+		};
+
+		// whether some FDE has unwind rules for pc
+		bool covers(file_addr pc) const;
+
+		// compiled once per FDE and kept for later unwinds through it
+		const unwind_plan& plan_at(file_addr pc) const;
+		const unwind_row& row_at(file_addr pc) const;
 		
 	private:
+		// nullptr if no FDE covers pc
+		const unwind_plan* find_plan(file_addr pc) const;
+		const unwind_plan& plan_for(
+			std::size_t index, const std::byte* fde_start, bool debug_frame) const;
+		void build_fde_table() const;
+
 		const dwarf* dwarf_; // dwarf unit call frame belongs to
-		mutable std::unordered_map<std::uint32_t, common_information_entry> cie_map_; // offset to cie
+		mutable std::mutex cie_mutex_;
+		// by position, since .eh_frame and .debug_frame may be in different files
+		mutable std::unordered_map<const std::byte*, common_information_entry> cie_map_;
 		eh_hdr eh_hdr_;
+
+		// one slot per eh_frame_hdr search table entry, then one per
+		// fde_table_ entry. the table is sorted by address and built on
+		// the first lookup eh_frame_hdr can't answer
+		mutable std::mutex plans_mutex_;
+		mutable std::vector<std::unique_ptr<unwind_plan>> plans_;
+		mutable bool fde_table_built_ = false;
+		mutable std::vector<fde_table_entry> fde_table_;
 	};
 
 
@@ -162,12 +244,44 @@ namespace sdb {
 	struct attr_spec {
 		std::uint64_t attr;
 		std::uint64_t form;
+		// offset from the start of the DIE's attributes, only known up to
+		// and including the abbreviation's first variable-size attribute
+		std::size_t offset;
+		// size and count of the run of fixed-size forms starting at this
+		// attribute, so that it can be skipped in one step. zero for a
+		// variable-size form
+		std::uint32_t fixed_run_size;
+		std::uint32_t fixed_run_length;
 	};
 	struct abbrev {
 		std::uint64_t code;
 		std::uint64_t tag;
 		bool has_children;
-		std::vector<attr_spec> attr_specs;
+		span<const attr_spec> attr_specs;
+		// index of the first attribute with a variable-size form (or the
+		// attribute count) and the total size of the attributes before it
+		std::size_t first_variable_attr;
+		std::size_t fixed_size;
+	};
+
+	// abbreviations of one table, sorted by code, with the attribute
+	// specs of all of them stored back to back
+	class abbrev_table {
+	public:
+		abbrev_table(std::vector<abbrev> abbrevs,
+			std::vector<attr_spec> attr_specs);
+
+		abbrev_table(const abbrev_table&) = delete;
+		abbrev_table& operator=(const abbrev_table&) = delete;
+		abbrev_table(abbrev_table&&) = default;
+
+		const abbrev* find(std::uint64_t code) const;
+
+	private:
+		std::vector<abbrev> abbrevs_;
+		std::vector<attr_spec> attr_specs_;
+		// codes run 1..n, so a code is an index
+		bool dense_;
 	};
 
 	class dwarf;
@@ -196,7 +310,10 @@ namespace sdb {
 		{}
 
 		const compile_unit& cu() const { return *cu_; }
-		const std::vector<file>& file_names() const { return file_names_; }
+		const std::vector<file>& file_names() const {
+			decode();
+			return file_names_;
+		}
 
 		line_table(const line_table&) = delete;
 		line_table& operator=(const line_table&) = delete;
@@ -213,6 +330,14 @@ namespace sdb {
 			std::filesystem::path path, std::size_t line) const;
 
 	private:
+		friend class dwarf;
+
+		void decode() const;
+		void run_program() const;
+		bool execute_instruction(const std::byte*& pos,
+			entry& registers, entry& current) const;
+		entry row(std::size_t index) const;
+
 		sdb::span<const std::byte> data_;
 		const compile_unit* cu_;
 		bool default_is_stmt_;
@@ -221,6 +346,43 @@ namespace sdb {
 		std::uint8_t opcode_base_;
 		std::vector<std::filesystem::path> include_directories_;
 		mutable std::vector<file> file_names_;
+
+		// the line program is run once, the first time the table is
+		// queried, and its rows are kept column by column
+		enum row_flags : std::uint8_t {
+			is_stmt_flag = 1 << 0,
+			basic_block_start_flag = 1 << 1,
+			end_sequence_flag = 1 << 2,
+			prologue_end_flag = 1 << 3,
+			epilogue_begin_flag = 1 << 4,
+		};
+		struct rows {
+			std::vector<std::uint64_t> addresses;
+			std::vector<std::uint32_t> lines;
+			std::vector<std::uint32_t> columns;
+			std::vector<std::uint32_t> file_indices;
+			std::vector<std::uint32_t> discriminators;
+			std::vector<std::uint8_t> flags;
+		};
+		// the columns of decoded_rows_, or of the index cache if the
+		// rows came from there
+		struct row_columns {
+			span<const std::uint64_t> addresses;
+			span<const std::uint32_t> lines;
+			span<const std::uint32_t> columns;
+			span<const std::uint32_t> file_indices;
+			span<const std::uint32_t> discriminators;
+			span<const std::uint8_t> flags;
+		};
+		mutable std::once_flag decode_once_;
+		mutable rows decoded_rows_;
+		mutable row_columns rows_;
+		// address range of each sequence to its first and end_sequence rows
+		struct sequence {
+			std::size_t first_row;
+			std::size_t end_row;
+		};
+		mutable range_index<sequence> sequences_;
 	};
 
 	struct line_table::entry {
@@ -253,7 +415,7 @@ namespace sdb {
 		using difference_type = std::ptrdiff_t;
 		using iterator_category = std::forward_iterator_tag;
 
-		iterator(const line_table* table_);
+		iterator(const line_table* table, std::size_t index);
 
 		iterator() = default;
 		iterator(const iterator&) = default;
@@ -262,43 +424,82 @@ namespace sdb {
 		const line_table::entry& operator*() const { return current_; }
 		const line_table::entry* operator->() const { return &current_; }
 
-		bool operator==(const iterator& rhs) const { return pos_ == rhs.pos_; }
-		bool operator!=(const iterator& rhs) const { return pos_ != rhs.pos_; }
+		bool operator==(const iterator& rhs) const {
+			return table_ == rhs.table_ and index_ == rhs.index_;
+		}
+		bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
 
 		iterator& operator++();
 		iterator operator++(int);
 
 	private:
-		bool execute_instruction();
-
-		const line_table* table_;
+		const line_table* table_ = nullptr;
+		std::size_t index_ = 0;
 		line_table::entry current_;
-		line_table::entry registers_;
-		const std::byte* pos_;
 	};
 
 
 
+	// subprogram, inlined subroutine and lexical block scopes of one
+	// unit, nested as in the DIE tree. every scope keeps the flattened
+	// ranges of its children sorted by address, so finding the scopes
+	// around an address is one descent with a binary search per level
+	class scope_tree {
+	public:
+		explicit scope_tree(const compile_unit& cu);
+
+		struct scope {
+			const std::byte* position;
+			std::uint64_t tag;
+			std::uint32_t first_child_range;
+			std::uint32_t last_child_range;
+		};
+
+		// outermost first, not including the unit itself
+		std::vector<const scope*> scopes_containing(std::uint64_t address) const;
+
+	private:
+		struct range {
+			std::uint64_t low;
+			std::uint64_t high;
+			std::uint32_t scope;
+		};
+
+		std::uint32_t add_scope(const die& d, std::uint64_t tag);
+		void collect_children(const die& parent, std::vector<range>& out);
+
+		// the first scope is the unit
+		std::vector<scope> scopes_;
+		std::vector<range> ranges_;
+	};
+
 	class die;
 	class compile_unit {
 	public:
-		compile_unit(dwarf& parent,
+		compile_unit(const dwarf& parent,
 			span<const std::byte> data,
 			std::size_t abbrev);
 
 		const dwarf* dwarf_info() const { return parent_; }
 		span<const std::byte> data() const { return data_; }
 
-		const std::unordered_map<std::uint64_t, sdb::abbrev>&
-			abbrev_table() const;
+		const sdb::abbrev_table& abbrev_table() const;
 
 		die root() const;
-		const line_table& lines() const { return *line_table_; }
+		const line_table& lines() const;
+		const scope_tree& scopes() const;
 	private:
-		dwarf* parent_;
+		const dwarf* parent_;
 		span<const std::byte> data_;
 		std::size_t abbrev_offset_;
-		std::unique_ptr<line_table> line_table_;
+
+		// looked up or parsed on first use
+		mutable std::once_flag abbrev_table_once_;
+		mutable const sdb::abbrev_table* abbrev_table_ = nullptr;
+		mutable std::once_flag line_table_once_;
+		mutable std::unique_ptr<line_table> line_table_;
+		mutable std::once_flag scope_tree_once_;
+		mutable std::unique_ptr<scope_tree> scope_tree_;
 	};
 
 	struct source_location {
@@ -310,9 +511,9 @@ namespace sdb {
 	public:
 		explicit die(const std::byte* next) : next_(next) {}
 		die(const std::byte* pos, const compile_unit* cu, const abbrev* abbrev,
-			std::vector<const std::byte*> attr_locs, const std::byte* next) :
+			const std::byte* attrs, const std::byte* next) :
 			pos_(pos), cu_(cu), abbrev_(abbrev),
-			attr_locs_(std::move(attr_locs)), next_(next) {}
+			attrs_(attrs), next_(next) {}
 
 		const compile_unit* cu() const { return cu_; }
 		const abbrev* abbrev_entry() const { return abbrev_; }
@@ -337,11 +538,13 @@ namespace sdb {
 		std::uint64_t line() const;
 
 	private:
+		const std::byte* attr_location(std::size_t index) const;
+
 		const std::byte* pos_ = nullptr;
 		const compile_unit* cu_ = nullptr;
 		const abbrev* abbrev_ = nullptr;
+		const std::byte* attrs_ = nullptr;
 		const std::byte* next_ = nullptr;
-		std::vector<const std::byte*> attr_locs_;
 	};
 
 	class die::children_range {
@@ -389,11 +592,14 @@ namespace sdb {
 	class dwarf {
 	public:
 		dwarf(const elf& parent);
+		~dwarf();
 		const elf* elf_file() const { return elf_; }
-		const std::unordered_map<std::uint64_t, abbrev>& get_abbrev_table(
-			std::size_t offset);
+		// where the sections are read from, which is elf_file() unless
+		// its DWARF was split off into a separate debug file
+		const elf* debug_file() const { load_sections(); return debug_file_; }
+		const abbrev_table& get_abbrev_table(std::size_t offset) const;
 		const std::vector<std::unique_ptr<compile_unit>>&
-			compile_units() const { return compile_units_; }
+			compile_units() const;
 
 		const compile_unit* compile_unit_containing_address(
 			file_addr address) const;
@@ -402,6 +608,12 @@ namespace sdb {
 
 		std::vector<die> find_functions(std::string name) const;
 
+		// units that may define the given name. uses .debug_names or
+		// .gdb_index when the file has one instead of indexing every DIE
+		std::vector<const compile_unit*> compile_units_with_name(
+			std::string_view name) const;
+		bool has_name_index() const { load_sections(); return name_index_ != nullptr; }
+
 		line_table::iterator line_entry_at_address(file_addr address) const {
 			auto cu = compile_unit_containing_address(address);
 			if (!cu) return {};
@@ -410,24 +622,126 @@ namespace sdb {
 
 		std::vector<die> inline_stack_at_address(file_addr address) const;
 
-		const call_frame_information& cfi() const { return *cfi_; }
+		std::vector<line_table::iterator> line_entries_by_line(
+			const std::filesystem::path& path, std::size_t line) const;
+
+		const call_frame_information& cfi() const;
+
+		span<const std::byte> debug_info() const { load_sections(); return debug_info_; }
+		span<const std::byte> debug_abbrev() const { load_sections(); return debug_abbrev_; }
+		span<const std::byte> debug_str() const { load_sections(); return debug_str_; }
+		span<const std::byte> debug_line() const { load_sections(); return debug_line_; }
+		span<const std::byte> debug_ranges() const { load_sections(); return debug_ranges_; }
+		span<const std::byte> eh_frame() const { load_sections(); return eh_frame_; }
+		span<const std::byte> debug_frame() const { load_sections(); return debug_frame_; }
+
+		// queues indexing functions on the shared worker pool. a lookup
+		// that gets there first indexes on its own thread instead
+		void index_in_background() const;
+
+		// loads the function index, compile unit ranges and line table
+		// rows from a file in directory, or builds them and writes the
+		// file there if it's missing or stale. that happens on the first
+		// lookup they could answer, or on the shared worker pool if
+		// in_background is set
+		void use_index_cache(const std::filesystem::path& directory,
+			bool in_background = false) const;
+		bool index_cache_loaded() const { return index_cache_loaded_; }
 	private:
+		friend class line_table;
+		struct function_index_shard;
+
+		void load_sections() const;
 		void index() const;
-		void index_die(const die& current) const;
+		void build_index() const;
+		void index_die(const die& current, function_index_shard& shard) const;
+		const function_index_shard& unit_functions(const compile_unit& cu) const;
+		const compile_unit* compile_unit_at_offset(std::size_t offset) const;
+		void build_compile_unit_ranges() const;
+		void build_line_index() const;
+		void open_index_cache() const;
+		bool load_index_cache(const std::filesystem::path& path) const;
+		void write_index_cache(const std::filesystem::path& path) const;
+		bool load_cached_line_rows(const line_table& table) const;
 
 		const elf* elf_;
-		std::unordered_map<std::size_t,
-			std::unordered_map<std::uint64_t, abbrev>> abbrev_tables_;
-		std::vector<std::unique_ptr<compile_unit>> compile_units_;
+
+		// looked up on first use, since that may mean finding and
+		// mapping a separate debug file
+		mutable std::once_flag sections_once_;
+		mutable const elf* debug_file_ = nullptr;
+		mutable span<const std::byte> debug_info_;
+		mutable span<const std::byte> debug_abbrev_;
+		mutable span<const std::byte> debug_str_;
+		mutable span<const std::byte> debug_line_;
+		mutable span<const std::byte> debug_ranges_;
+		mutable span<const std::byte> eh_frame_;
+		mutable span<const std::byte> debug_frame_;
+
+		mutable std::mutex abbrev_tables_mutex_;
+		mutable std::unordered_map<std::size_t, abbrev_table> abbrev_tables_;
+
+		// unit headers, line tables and call frame information are only
+		// parsed once something asks for them
+		mutable std::once_flag compile_units_once_;
+		mutable std::vector<std::unique_ptr<compile_unit>> compile_units_;
 
 		struct index_entry {
 			const compile_unit* cu;
 			const std::byte* pos;
 		};
-		mutable std::unordered_multimap<std::string, index_entry>
+		// sorted by name, names point into the debug file
+		mutable std::vector<std::pair<std::string_view, index_entry>>
 			function_index_;
 
-		std::unique_ptr<call_frame_information> cfi_;
+		// address ranges of every indexed subprogram and inlined subroutine
+		struct function_range_entry {
+			index_entry entry;
+			std::uint64_t tag;
+		};
+		mutable range_index<function_range_entry> function_ranges_;
+		mutable std::once_flag index_once_;
+		mutable std::atomic<bool> indexed_{ false };
+
+		// prebuilt name table from the file, if it has one, and the
+		// functions of the units it pointed lookups at
+		mutable std::unique_ptr<name_index> name_index_;
+		mutable std::mutex unit_functions_mutex_;
+		mutable std::unordered_map<const compile_unit*,
+			std::unique_ptr<function_index_shard>> unit_functions_;
+
+		// one entry per CU range list entry, built on first lookup
+		mutable std::once_flag compile_unit_ranges_once_;
+		mutable range_index<const compile_unit*> compile_unit_ranges_;
+
+		// line table rows of every CU grouped by source file and sorted
+		// by line, built on the first line lookup
+		struct line_index_row {
+			std::uint64_t line;
+			const line_table* table;
+			std::size_t row;
+		};
+		struct line_index_file {
+			std::filesystem::path path;
+			std::vector<line_index_row> rows;
+		};
+		mutable std::once_flag line_index_once_;
+		mutable std::vector<line_index_file> line_index_files_;
+		mutable std::unordered_map<std::string, std::vector<std::size_t>>
+			line_index_by_filename_;
+
+		mutable std::once_flag cfi_once_;
+		mutable std::unique_ptr<call_frame_information> cfi_;
+
+		// mapped index cache file that line table rows are read in place from
+		mutable std::filesystem::path index_cache_directory_;
+		mutable std::once_flag index_cache_once_;
+		mutable span<const std::byte> index_cache_;
+		mutable std::atomic<bool> index_cache_loaded_{ false };
+
+		// indexing or cache loading queued on the worker pool, ~dwarf waits
+		// for it before anything it reads goes away
+		mutable std::future<void> background_index_;
 	};
 }
 
@@ -7,6 +7,8 @@
 #include <string_view>
 #include <unordered_map>
 #include <map>
+#include <mutex>
+#include <string>
 #include <optional>
 #include <libsdb/types.hpp>
 
@@ -14,15 +16,29 @@
 namespace sdb {
     class dwarf;
 
+    struct elf_options {
+        // queue indexing DWARF functions on the shared worker pool as soon
+        // as the file is loaded instead of waiting for the first lookup
+        bool index_in_background = false;
+
+        // directory for on-disk DWARF index files; caching is off if empty
+        std::filesystem::path index_cache_directory;
+
+        // where to look for separate debug files, by build ID under
+        // .build-id/ and by .gnu_debuglink under the binary's own path
+        std::vector<std::filesystem::path> debug_directories{ "/usr/lib/debug" };
+    };
+
     class elf {
     public:
-        elf(const std::filesystem::path& path);
+        elf(const std::filesystem::path& path, elf_options options = {});
         ~elf();
 
         elf(const elf&) = delete;
         elf& operator=(const elf&) = delete;
         
         std::filesystem::path path() const { return path_; }
+        std::size_t file_size() const { return file_size_; }
         const Elf64_Ehdr& get_header() const { return header_; }
 
         std::string_view get_section_name(std::size_t index) const;
@@ -32,6 +48,14 @@ namespace sdb {
 
         std::string_view get_string(std::size_t index) const;
 
+        // contents of the NT_GNU_BUILD_ID note, empty if there isn't one
+        span<const std::byte> build_id() const;
+
+        // the file DWARF is read from: this one if it has a .debug_info,
+        // otherwise a separate debug file if one can be found and read.
+        // that is searched for and mapped on the first call
+        const elf& debug_file() const;
+
         virt_addr load_bias() const {
             return load_bias_;
         }
@@ -43,8 +67,15 @@ namespace sdb {
         const Elf64_Shdr* get_section_containing_address(file_addr addr) const;
         const Elf64_Shdr* get_section_containing_address(virt_addr addr) const;
 
+        // SHF_ALLOC sections that take up address space, sorted by address
+        const std::vector<const Elf64_Shdr*>& loaded_sections() const {
+            return loaded_sections_;
+        }
+
         std::optional<file_addr> get_section_start_addr(std::string_view name) const;
 
+        // matches mangled and demangled names. the first lookup of a name
+        // that could be a demangled one demangles every C++ symbol
         std::vector<const Elf64_Sym*> get_symbols_by_name(std::string_view name) const;
 
         std::optional<const Elf64_Sym*> get_symbol_at_address(file_addr addr) const;
@@ -67,8 +98,14 @@ namespace sdb {
     private:
         void parse_section_headers();
         void parse_symbol_table();
+        void find_symbol_hash_tables(const Elf64_Shdr& dynsym);
         void build_section_map();
-        void build_symbol_maps();
+        std::unique_ptr<elf> find_debug_file() const;
+        void build_symbol_maps() const;
+        bool get_dynamic_symbols_by_name(
+            std::string_view name, std::vector<const Elf64_Sym*>& ret) const;
+        void demangle_symbol_names() const;
+        const Elf64_Sym* symbol_at_or_before(std::uint64_t address) const;
 
         int fd_;
         std::filesystem::path path_;
@@ -76,34 +113,59 @@ namespace sdb {
         std::byte* data_;
         Elf64_Ehdr header_;
         std::vector<Elf64_Shdr> section_headers_;
-        std::vector<Elf64_Sym> symbol_table_;
+        // points into the mapped file
+        span<const Elf64_Sym> symbol_table_;
         std::map<std::string_view, Elf64_Shdr*> section_map_;
+        std::vector<const Elf64_Shdr*> loaded_sections_;
         virt_addr load_bias_;
 
+        std::vector<std::filesystem::path> debug_directories_;
+        mutable std::once_flag debug_file_once_;
+        mutable std::unique_ptr<elf> debug_file_;
+
         std::unique_ptr<dwarf> dwarf_;
 
-        // symbol_name ---> symbols
-        std::unordered_multimap<std::string_view, Elf64_Sym*> symbol_name_map_;
+        // the dynamic linker's hash tables for .dynsym. when that's the
+        // only symbol table, name lookups go through these and the
+        // indices below aren't built until something else needs them
+        span<const std::byte> gnu_hash_;
+        span<const std::byte> sysv_hash_;
 
-        struct range_comparator {
-            bool operator()(
-              std::pair<file_addr, file_addr> lhs,
-              std::pair<file_addr, file_addr> rhs
-            ) const {
-                return lhs.first < rhs.first;
-            }
+        // symbol indices by hash of the name, sorted by hash
+        struct symbol_name_entry {
+            std::uint32_t hash;
+            std::uint32_t symbol;
         };
-
-        // address_range ---> symbol
-        std::map<std::pair<file_addr, file_addr>, Elf64_Sym*, range_comparator> symbol_addr_map_;  
+        mutable std::once_flag symbol_maps_once_;
+        mutable std::vector<symbol_name_entry> symbol_name_index_;
+
+        // the same for demangled names of C++ symbols, which are kept
+        // null terminated in demangled_names_
+        struct demangled_name_entry {
+            std::uint32_t hash;
+            std::uint32_t symbol;
+            std::uint32_t name;
+        };
+        mutable std::once_flag demangle_once_;
+        mutable std::string demangled_names_;
+        mutable std::vector<demangled_name_entry> demangled_name_index_;
+
+        // indices of symbols with an address, one per address, in
+        // Eytzinger order: a binary search tree laid out breadth first
+        // with the root at 1, so searches touch memory front to back
+        mutable std::vector<std::uint32_t> symbol_address_index_;
     };
 
     class elf_collection {
     public:
         void push(std::unique_ptr<elf> elf) {
+            index(*elf);
             elves_.push_back(std::move(elf));
         }
 
+        // moves an ELF that's already in the collection
+        void notify_loaded(const elf& obj, virt_addr address);
+
         template <class F>
         void for_each(F f) {
             for (auto& elf : elves_) {
@@ -124,7 +186,19 @@ namespace sdb {
         const elf* get_elf_by_filename(std::string_view name) const;
 
     private:
+        void index(const elf& obj);
+        void unindex(const elf& obj);
+
         std::vector<std::unique_ptr<elf>> elves_;
+
+        // loaded sections of every ELF at their load addresses, sorted
+        // by address and kept up to date as ELFs are added or moved
+        struct loaded_range {
+            std::uint64_t low;
+            std::uint64_t high;
+            const elf* obj;
+        };
+        std::vector<loaded_range> ranges_;
     };
 }
 
@@ -0,0 +1,42 @@
+#ifndef SDB_MEMORY_SNAPSHOT_HPP
+#define SDB_MEMORY_SNAPSHOT_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <libsdb/types.hpp>
+
+namespace sdb {
+    class process;
+
+    // copy of inferior memory from start upwards, read in a few large
+    // chunks that grow on demand. meant for a stopped thread's stack so
+    // that unwinding doesn't cost a syscall per saved register
+    class memory_snapshot {
+    public:
+        memory_snapshot(const process& proc, virt_addr start,
+            std::size_t initial_size = 4096);
+
+        // reads outside the snapshot go straight to the process
+        std::uint64_t read_u64(virt_addr address);
+
+        std::size_t reads() const { return reads_; }
+        std::size_t syscalls() const { return syscalls_; }
+
+    private:
+        void extend(std::size_t end);
+
+        // never copy more than this much of the stack
+        static constexpr std::size_t max_size_ = 8 * 1024 * 1024;
+
+        const process* proc_;
+        virt_addr start_;
+        std::vector<std::byte> data_;
+        std::size_t next_size_;
+        bool exhausted_ = false;
+        std::size_t reads_ = 0;
+        std::size_t syscalls_ = 0;
+    };
+}
+
+#endif
@@ -112,6 +112,18 @@ namespace sdb {
         bool pending_sigstop = false; // wether or not the thread has a pending SIGSTOP singal to handle
     };
 
+    // one line of /proc/<pid>/maps
+    struct memory_region {
+        virt_addr start;
+        virt_addr end;
+        bool readable = false;
+        bool writable = false;
+        bool executable = false;
+        std::string path;
+
+        bool contains(virt_addr addr) const { return start <= addr and addr < end; }
+    };
+
     class target;
 
     class process {
@@ -224,6 +236,7 @@ namespace sdb {
 
         // function for getting auxilary vectors
         std::unordered_map<int, std::uint64_t> get_auxv() const;
+        std::vector<memory_region> get_memory_map() const;
 
         void set_target(target* tgt) { target_ = tgt; }
 
@@ -0,0 +1,80 @@
+#ifndef SDB_RANGE_INDEX_HPP
+#define SDB_RANGE_INDEX_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace sdb {
+    // flattened, sorted table of [low, high) address ranges.
+    // ranges may nest (a function and the functions inlined into it), so
+    // every entry also records the highest end address seen up to it. a
+    // lookup binary searches for the last range starting at or before the
+    // address and walks back only while an earlier range could still cover it
+    template <class T>
+    class range_index {
+    public:
+        struct entry {
+            std::uint64_t low;
+            std::uint64_t high;
+            T value;
+
+            bool contains(std::uint64_t address) const {
+                return low <= address and address < high;
+            }
+        };
+
+        void insert(std::uint64_t low, std::uint64_t high, T value) {
+            if (low < high) {
+                entries_.push_back({ low, high, std::move(value) });
+            }
+        }
+
+        // must be called once all ranges are inserted and before any lookup
+        void finalize() {
+            // outer ranges sort before the ranges nested in them
+            std::stable_sort(entries_.begin(), entries_.end(),
+                [](auto& lhs, auto& rhs) {
+                    if (lhs.low != rhs.low) return lhs.low < rhs.low;
+                    return lhs.high > rhs.high;
+                });
+
+            max_high_.resize(entries_.size());
+            std::uint64_t max_high = 0;
+            for (std::size_t i = 0; i < entries_.size(); ++i) {
+                max_high = std::max(max_high, entries_[i].high);
+                max_high_[i] = max_high;
+            }
+        }
+
+        // innermost range containing address that satisfies pred
+        template <class F>
+        const entry* find(std::uint64_t address, F pred) const {
+            auto it = std::upper_bound(entries_.begin(), entries_.end(), address,
+                [](std::uint64_t addr, auto& e) { return addr < e.low; });
+
+            for (auto i = static_cast<std::size_t>(it - entries_.begin()); i > 0; --i) {
+                if (max_high_[i - 1] <= address) break;
+                auto& e = entries_[i - 1];
+                if (e.contains(address) and pred(e)) return &e;
+            }
+            return nullptr;
+        }
+
+        const entry* find(std::uint64_t address) const {
+            return find(address, [](auto&) { return true; });
+        }
+
+        bool empty() const { return entries_.empty(); }
+        std::size_t size() const { return entries_.size(); }
+
+        const std::vector<entry>& entries() const { return entries_; }
+
+    private:
+        std::vector<entry> entries_;
+        std::vector<std::uint64_t> max_high_;
+    };
+}
+
+#endif
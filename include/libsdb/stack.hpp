@@ -2,14 +2,39 @@
 #define SDB_STACK_HPP
 
 #include <vector>
+#include <array>
+#include <memory>
+#include <limits>
 #include <libsdb/dwarf.hpp>
 #include <libsdb/registers.hpp>
+#include <libsdb/process.hpp>
+#include <libsdb/memory_snapshot.hpp>
 
 namespace sdb {
     class target;
 
+    // what unwinding into a frame changed in the registers of the frame
+    // below it. only rsp and the callee-saved registers survive a call,
+    // so those are all the unwinder recovers
+    struct register_delta {
+        static constexpr std::array<register_id, 7> ids = {
+            register_id::rsp, register_id::rbp, register_id::rbx,
+            register_id::r12, register_id::r13, register_id::r14, register_id::r15
+        };
+
+        std::array<std::uint64_t, ids.size()> values{};
+        std::uint8_t changed = 0; // bit i set if ids[i] got a new value
+        std::uint8_t undefined = 0; // bit i set if ids[i] can't be recovered
+
+        void apply(registers& regs) const;
+    };
+
+    // full register sets are rebuilt from the deltas only for the
+    // frame the user selects, see stack::regs
     struct stack_frame {
-        registers regs;
+        virt_addr pc; // rip in this frame
+        virt_addr cfa;
+        register_delta regs;
         virt_addr backtrace_report_address;
         die func_die;
         bool inlined = false;
@@ -22,49 +47,104 @@ namespace sdb {
         stack(target* tgt, pid_t tid) : target_(tgt), tid_(tid) {}
         void reset_inline_height();
         std::vector<sdb::die> inline_stack_at_pc() const;
-        std::uint32_t inline_height() const { return inline_height_; }
+        std::uint32_t inline_height() const { sync(); return inline_height_; }
         const target& get_target() const { return *target_; }
 
         void simulate_inlined_step_in() {
             // stepping into inline function
+            sync();
             --inline_height_;
             current_frame_ = inline_height_;
         }
 
+        // frames are unwound lazily, the first time something asks for
+        // them after the target stops. this unwinds all of them now
         void unwind();
-        void up() { ++current_frame_; }
-        void down() { --current_frame_; }
+        void up();
+        void down();
 
         span<const stack_frame> frames() const;
-        bool has_frames() const { return !frames_.empty(); }
+        // only unwinds as far as needed for the first max_frames frames
+        span<const stack_frame> frames(std::size_t max_frames) const;
+        bool has_frames() const { return frames(1).size() != 0; }
+
+        // the innermost and outermost n frames of a possibly huge stack.
+        // frames in between are unwound to count them, but not kept
+        struct frame_summary {
+            span<const stack_frame> innermost;
+            std::vector<stack_frame> outermost;
+            std::size_t total = 0;
+        };
+        frame_summary summarize_frames(std::size_t n) const;
+
+        // follows the saved rbp chain only: cheap, but needs frame pointers
+        // and finds no inline frames. the first address is the pc, the rest
+        // are return addresses
+        std::vector<virt_addr> frame_pointer_backtrace(
+            std::size_t max_frames = std::numeric_limits<std::size_t>::max()) const;
         
-        const stack_frame& current_frame() const { return frames_[current_frame_]; }
+        const stack_frame& current_frame() const;
         std::size_t current_frame_index() const { 
+            sync();
             return current_frame_ - inline_height_;
         }
 
+        // registers of the current frame, rebuilt from the deltas of
+        // every frame below it
         const registers& regs() const;
         virt_addr get_pc() const;
 
     private:
+        // where unwinding left off: the next physical frame's registers
+        // and what they changed relative to the one before
+        struct unwind_cursor {
+            registers regs;
+            register_delta delta;
+            virt_addr pc;
+            bool done = false;
+        };
+
+        // starts over if the target has stopped since the frames were
+        // last looked at
+        void sync() const;
+        void compute_inline_height() const;
+        void unwind_until(std::size_t n_frames) const;
+        bool unwind_next() const { return unwind_next(cursor_, frames_); }
+        bool unwind_next(unwind_cursor& cursor, std::vector<stack_frame>& out) const;
+        // steps to the caller's rip/rsp/rbp if rbp points at a frame record
+        // on this thread's stack
+        bool unwind_frame_pointer(
+            std::uint64_t& rip, std::uint64_t& rsp, std::uint64_t& rbp) const;
+
         void create_inline_stack_frames(
-            const sdb::registers& regs,
+            std::vector<stack_frame>& out,
             const std::vector<sdb::die> inline_stack,
             file_addr pc
-        );
+        ) const;
 
         void create_base_frame(
-            const sdb::registers& regs,
+            std::vector<stack_frame>& out,
             const std::vector<sdb::die> inline_stack,
             file_addr pc,
             bool inlined
-        );
+        ) const;
 
         pid_t tid_ = 0;
         target* target_ = nullptr;
-        std::uint32_t inline_height_ = 0; // location at which process stopped
-        std::vector<stack_frame> frames_;
-        std::size_t current_frame_;
+        mutable std::uint32_t inline_height_ = 0; // location at which process stopped
+        mutable std::vector<stack_frame> frames_;
+        mutable std::size_t current_frame_ = 0;
+
+        // stop the frames belong to and where unwinding left off
+        mutable std::uint64_t epoch_ = 0;
+        mutable registers base_regs_;
+        mutable unwind_cursor cursor_;
+        mutable std::unique_ptr<memory_snapshot> stack_memory_;
+        mutable std::optional<memory_region> stack_region_;
+
+        // registers of the last frame regs() was asked about
+        mutable std::optional<registers> selected_regs_;
+        mutable std::size_t selected_frame_ = 0;
     };
 }
 
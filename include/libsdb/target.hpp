@@ -2,6 +2,8 @@
 #define SDB_TARGET_HPP
 
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <link.h>
 #include <libsdb/process.hpp>
 #include <libsdb/elf.hpp>
@@ -26,14 +28,19 @@ namespace sdb
 
         static std::unique_ptr<target> launch(
             std::filesystem::path path,
-            std::optional<int> stdout_replacement = std::nullopt
+            std::optional<int> stdout_replacement = std::nullopt,
+            elf_options options = {}
         );
-        static std::unique_ptr<target> attach(pid_t pid);
+        static std::unique_ptr<target> attach(
+            pid_t pid, elf_options options = {});
 
         process& get_process() { return *process_; }
         const process& get_process() const { return *process_; }
 
         void notify_stop(const sdb::stop_reason& reason);
+        void notify_memory_write();
+        // bumped on every stop, so stacks know when to unwind again
+        std::uint64_t stop_epoch() const { return stop_epoch_; }
 
         file_addr get_pc_file_address(std::optional<pid_t> otid = std::nullopt) const;
 
@@ -46,6 +53,20 @@ namespace sdb
         }
 
         sdb::line_table::iterator line_entry_at_pc(std::optional<pid_t> otid = std::nullopt) const;
+        std::optional<die> function_at_pc(std::optional<pid_t> otid = std::nullopt) const;
+        std::vector<die> inline_stack_at_pc(std::optional<pid_t> otid = std::nullopt) const;
+        std::string function_name_at_pc(std::optional<pid_t> otid = std::nullopt) const;
+
+        // lookups of a thread's pc are remembered until the thread moves,
+        // the process stops again or memory is written
+        struct location_cache_stats {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+        };
+        location_cache_stats location_cache_statistics() const {
+            return { location_cache_hits_, location_cache_misses_ };
+        }
+
         sdb::stop_reason run_until_address(
             virt_addr address, std::optional<pid_t> otid = std::nullopt);
 
@@ -76,6 +97,17 @@ namespace sdb
             breakpoints() const { return breakpoints_; }
 
         std::string function_name_at_address(virt_addr address) const;
+
+        // one thread's frames and the function each of them is in
+        struct thread_backtrace {
+            pid_t tid;
+            span<const stack_frame> frames;
+            std::vector<std::string> function_names;
+        };
+        // unwinds and names the frames of every stopped thread on a pool
+        // of workers. stack memory is read with process_vm_readv, which
+        // doesn't care which thread calls it
+        std::vector<thread_backtrace> backtrace_all_threads() const;
         
         std::optional<r_debug> read_dynamic_linker_rendezvous() const;
 
@@ -100,9 +132,11 @@ namespace sdb
         void notify_thread_lifecycle_event(const sdb::stop_reason& reason);
 
     private:
-        target(std::unique_ptr<process> proc, std::unique_ptr<elf> obj)
+        target(std::unique_ptr<process> proc, std::unique_ptr<elf> obj,
+            elf_options options)
             : process_(std::move(proc))
-            , main_elf_(obj.get()) {
+            , main_elf_(obj.get())
+            , elf_options_(options) {
             elves_.push(std::move(obj));
             auto pid = process_->pid();
             for (auto& [tid, state] : process_->thread_states()) {
@@ -113,12 +147,39 @@ namespace sdb
         void resolve_dynamic_linker_rendezvous();
         void reload_dynamic_libraries();
 
+        sdb::stop_reason run_until_any_address(
+            const std::vector<virt_addr>& addresses, pid_t tid);
+        sdb::stop_reason step_line_range(pid_t tid, bool step_over_calls);
+
+        // each part is resolved on first use. threads unwound in parallel
+        // share the cache, so parts are copied out under the lock
+        struct pc_location {
+            std::uint64_t epoch = 0;
+            virt_addr pc;
+            file_addr file_address;
+            std::optional<line_table::iterator> line;
+            std::optional<std::optional<die>> function;
+            std::optional<std::vector<die>> inline_stack;
+            std::optional<std::string> function_name;
+        };
+        // the entry for tid at pc, location_cache_mutex_ must be held
+        pc_location& location_at_pc(pid_t tid, virt_addr pc) const;
+        template <class T, class F>
+        T cached_at_pc(std::optional<pid_t> otid,
+            std::optional<T> pc_location::* part, F resolve) const;
+
         std::unique_ptr<process> process_;
         elf_collection elves_;
         elf* main_elf_;
+        elf_options elf_options_;
         stoppoint_collection<breakpoint> breakpoints_;
         virt_addr dynamic_linker_rendezvous_address_;
         std::unordered_map<pid_t, thread> threads_;
+        std::uint64_t stop_epoch_ = 1;
+        mutable std::mutex location_cache_mutex_;
+        mutable std::unordered_map<pid_t, pc_location> location_cache_;
+        mutable std::atomic<std::uint64_t> location_cache_hits_{ 0 };
+        mutable std::atomic<std::uint64_t> location_cache_misses_{ 0 };
     };
 
 }
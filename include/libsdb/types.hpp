@@ -167,8 +167,8 @@ namespace sdb {
 
         T* begin() const { return data_; }
         T* end() const  { return data_ + size_; }
-        std::size_t size() { return size_; }
-        T& operator[](std::size_t n) { return *(data_ + n); }
+        std::size_t size() const { return size_; }
+        T& operator[](std::size_t n) const { return *(data_ + n); }
 
     private:
         T* data_ = nullptr;
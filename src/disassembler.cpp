@@ -1,6 +1,44 @@
 #include <Zydis/Zydis.h>
 #include <libsdb/disassembler.hpp>
 
+namespace {
+    sdb::disassembler::branch_kind branch_kind_of(const ZydisDecodedInstruction& info) {
+        using kind = sdb::disassembler::branch_kind;
+        switch (info.meta.category) {
+        case ZYDIS_CATEGORY_UNCOND_BR: return kind::jump;
+        case ZYDIS_CATEGORY_COND_BR: return kind::conditional_jump;
+        case ZYDIS_CATEGORY_CALL: return kind::call;
+        case ZYDIS_CATEGORY_RET: return kind::ret;
+        case ZYDIS_CATEGORY_SYSCALL:
+        case ZYDIS_CATEGORY_INTERRUPT:
+        case ZYDIS_CATEGORY_SYSTEM:
+            return kind::other;
+        default: return kind::none;
+        }
+    }
+
+    sdb::disassembler::instruction to_instruction(
+        const ZydisDisassembledInstruction& instr) {
+        sdb::disassembler::instruction ret;
+        ret.address = sdb::virt_addr{ instr.runtime_address };
+        ret.text = instr.text;
+        ret.length = instr.info.length;
+        ret.branch = branch_kind_of(instr.info);
+
+        // relative jumps and calls, anything through a register or
+        // memory is only known once it runs
+        ZyanU64 target;
+        if (ret.branch != sdb::disassembler::branch_kind::none and
+            instr.info.operand_count_visible > 0 and
+            instr.operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE and
+            ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(
+                &instr.info, &instr.operands[0], instr.runtime_address, &target))) {
+            ret.target = sdb::virt_addr{ target };
+        }
+        return ret;
+    }
+}
+
 std::vector<sdb::disassembler::instruction> sdb::disassembler::disassemble(
      std::size_t n_instructions,
     std::optional<virt_addr> address
@@ -20,11 +58,31 @@ std::vector<sdb::disassembler::instruction> sdb::disassembler::disassemble(
         ZYDIS_MACHINE_MODE_LONG_64, address->addr(),
         code.data() + offset, code.size() - offset, &instr)) and n_instructions > 0) 
     {
-        ret.push_back(instruction{*address, std::string(instr.text)});
+        ret.push_back(to_instruction(instr));
         offset += instr.info.length;
         *address += instr.info.length;
         --n_instructions;
     }
 
+    return ret;
+}
+
+std::vector<sdb::disassembler::instruction>
+sdb::disassembler::disassemble_range(virt_addr low, virt_addr high) {
+    std::vector<instruction> ret;
+    if (high <= low) return ret;
+
+    auto code = process_->read_memory_without_traps(low, high.addr() - low.addr());
+
+    ZyanUSize offset = 0;
+    ZydisDisassembledInstruction instr;
+    while (offset < code.size() and ZYAN_SUCCESS(ZydisDisassembleATT(
+        ZYDIS_MACHINE_MODE_LONG_64, (low + offset).addr(),
+        code.data() + offset, code.size() - offset, &instr)))
+    {
+        ret.push_back(to_instruction(instr));
+        offset += instr.info.length;
+    }
+
     return ret;
 }
\ No newline at end of file
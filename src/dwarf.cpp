@@ -2,36 +2,24 @@
 #include <algorithm>
 #include <variant>
 #include <tuple>
+#include <fstream>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <libsdb/dwarf.hpp>
 #include <libsdb/types.hpp>
 #include <libsdb/bit.hpp>
 #include <libsdb/elf.hpp>
 #include <libsdb/process.hpp>
+#include <libsdb/memory_snapshot.hpp>
 #include <libsdb/error.hpp>
+#include <parallel.hpp>
 
 
 namespace {
-	struct undefined_rule {};
-	struct same_rule {};
-	
-	struct offset_rule {
-		std::int64_t offset;	
-	};
-
-	struct val_offset_rule {
-		std::int64_t offset;
-	};
-
-	struct register_rule {
-		std::uint32_t reg;
-	};
-
-	struct cfa_register_rule {
-		std::uint32_t reg;
-		std::int64_t offset;
-	};
-
-
 	class cursor {
 	public:
 		explicit cursor(sdb::span<const std::byte> data)
@@ -71,34 +59,11 @@ namespace {
 		}
 
 		std::uint64_t uleb128() {
-			std::uint64_t res = 0;
-			int shift = 0;
-			std::uint8_t byte = 0;
-			do {
-				byte = u8();
-				auto masked = static_cast<uint64_t>(byte & 0x7f);
-				res |= masked << shift;
-				shift += 7;
-			} while ((byte & 0x80) != 0);
-			return res;
+			return sdb::decode_uleb128(pos_, data_.end());
 		}
 
 		std::int64_t sleb128() {
-			std::uint64_t res = 0;
-			int shift = 0;
-			std::uint8_t byte = 0;
-			do {
-				byte = u8();
-				auto masked = static_cast<uint64_t>(byte & 0x7f);
-				res |= masked << shift;
-				shift += 7;
-			} while ((byte & 0x80) != 0);
-
-			if ((shift < sizeof(res) * 8) and (byte & 0x40)) {
-				res |= (~static_cast<std::uint64_t>(0) << shift);
-			}
-
-			return res;
+			return sdb::decode_sleb128(pos_, data_.end());
 		}
 
 		void skip_form(std::uint64_t form) {
@@ -164,54 +129,130 @@ namespace {
 		const std::byte* pos_;
 	};
 
-	struct unwind_context {
+	using register_rule = sdb::call_frame_information::register_rule;
+	using unwind_row = sdb::call_frame_information::unwind_row;
+
+	// state of the CFI program while an FDE is compiled into rows
+	struct cfi_program {
 		cursor cur{ {nullptr, nullptr} };
-		sdb::file_addr location;
-		cfa_register_rule cfa_rule;
+		unwind_row row{};
+		// the row the CIE instructions set up, for DW_CFA_restore
+		unwind_row initial_row{};
+		std::vector<unwind_row> rule_stack;
+		std::vector<unwind_row> rows;
+
+		void set_rule(std::uint64_t reg, register_rule::kind type,
+			std::int64_t value = 0) {
+			if (reg < row.rules.size()) {
+				row.rules[reg] = { type, static_cast<std::int32_t>(value) };
+			}
+		}
 
-		using rule = std::variant<
-			undefined_rule, same_rule, offset_rule,
-			val_offset_rule, register_rule>;
-		
-		using ruleset = std::unordered_map<std::uint32_t, rule>;
-		ruleset cie_register_rules;
-		ruleset register_rules;
-		std::vector<std::pair<ruleset, cfa_register_rule>> rule_stack; 
+		void restore_rule(std::uint64_t reg) {
+			if (reg < row.rules.size()) {
+				row.rules[reg] = initial_row.rules[reg];
+			}
+		}
+
+		void advance_to(std::uint64_t location) {
+			if (location == row.location) return;
+			rows.push_back(row);
+			row.location = location;
+		}
 	};
 
 
-	std::unordered_map<std::uint64_t, sdb::abbrev>
-		parse_abbrev_table(const sdb::elf& obj, std::size_t offset) {
-		cursor cur(obj.get_section_contents(".debug_abbrev"));
+	// size of an attribute of the given form if it doesn't depend on its value
+	std::optional<std::size_t> fixed_form_size(std::uint64_t form) {
+		switch (form) {
+		case DW_FORM_flag_present:
+			return 0;
+		case DW_FORM_data1:
+		case DW_FORM_ref1:
+		case DW_FORM_flag:
+			return 1;
+		case DW_FORM_data2:
+		case DW_FORM_ref2:
+			return 2;
+		case DW_FORM_data4:
+		case DW_FORM_ref4:
+		case DW_FORM_ref_addr:
+		case DW_FORM_sec_offset:
+		case DW_FORM_strp:
+			return 4;
+		case DW_FORM_data8:
+		case DW_FORM_addr:
+			return 8;
+		default:
+			return std::nullopt;
+		}
+	}
+
+	sdb::abbrev_table parse_abbrev_table(
+		sdb::span<const std::byte> section, std::size_t offset) {
+		cursor cur(section);
 		cur += offset;
 
-		std::unordered_map<std::uint64_t, sdb::abbrev> table;
+		std::vector<sdb::abbrev> abbrevs;
+		std::vector<sdb::attr_spec> attr_specs;
+		std::vector<std::size_t> first_specs;
 		std::uint64_t code = 0;
 		do {
 			code = cur.uleb128();
+			if (code == 0) break;
 			auto tag = cur.uleb128();
 			auto has_children = static_cast<bool>(cur.u8());
 
-			std::vector<sdb::attr_spec> attr_specs;
+			auto first_spec = attr_specs.size();
+			std::size_t attr_offset = 0;
+			std::optional<std::size_t> first_variable;
 			std::uint64_t attr = 0;
 			do {
 				attr = cur.uleb128();
 				auto form = cur.uleb128();
 				if (attr != 0) {
-					attr_specs.push_back(sdb::attr_spec{ attr, form });
+					auto index = attr_specs.size() - first_spec;
+					attr_specs.push_back(sdb::attr_spec{ attr, form, attr_offset, 0, 0 });
+					if (first_variable) continue;
+
+					if (auto size = fixed_form_size(form); size) {
+						attr_offset += *size;
+					}
+					else {
+						first_variable = index;
+					}
 				}
 			} while (attr != 0);
 
-			if (code != 0) {
-				table.emplace(code, sdb::abbrev{ code, tag, has_children, std::move(attr_specs) });
+			for (auto i = attr_specs.size(); i-- > first_spec;) {
+				auto size = fixed_form_size(attr_specs[i].form);
+				if (!size) continue;
+				auto& spec = attr_specs[i];
+				spec.fixed_run_size = static_cast<std::uint32_t>(*size);
+				spec.fixed_run_length = 1;
+				if (i + 1 < attr_specs.size() and attr_specs[i + 1].fixed_run_length) {
+					spec.fixed_run_size += attr_specs[i + 1].fixed_run_size;
+					spec.fixed_run_length += attr_specs[i + 1].fixed_run_length;
+				}
 			}
+
+			auto n_specs = attr_specs.size() - first_spec;
+			abbrevs.push_back(sdb::abbrev{ code, tag, has_children, {},
+				first_variable.value_or(n_specs), attr_offset });
+			first_specs.push_back(first_spec);
 		} while (code != 0);
 
-		return table;
+		// the spec vector has stopped growing, so spans into it are stable
+		for (std::size_t i = 0; i < abbrevs.size(); ++i) {
+			auto end = i + 1 < abbrevs.size() ? first_specs[i + 1] : attr_specs.size();
+			abbrevs[i].attr_specs = { attr_specs.data() + first_specs[i],
+				attr_specs.data() + end };
+		}
+		return { std::move(abbrevs), std::move(attr_specs) };
 	}
 
 	std::unique_ptr<sdb::compile_unit> parse_compile_unit(
-		sdb::dwarf& dwarf, const sdb::elf& obj, cursor cur) {
+		const sdb::dwarf& dwarf, cursor cur) {
 		auto start = cur.position();
 		auto size = cur.u32();
 		auto version = cur.u16();
@@ -235,13 +276,12 @@ namespace {
 	}
 
 	std::vector<std::unique_ptr<sdb::compile_unit>> parse_compile_units(
-		sdb::dwarf& dwarf, const sdb::elf& obj) {
-		auto debug_info = obj.get_section_contents(".debug_info");
-		cursor cur(debug_info);
+		const sdb::dwarf& dwarf) {
+		cursor cur(dwarf.debug_info());
 
 		std::vector<std::unique_ptr<sdb::compile_unit>> units;
 		while (!cur.finished()) {
-			auto unit = parse_compile_unit(dwarf, obj, cur);
+			auto unit = parse_compile_unit(dwarf, cur);
 			cur += unit->data().size();
 			units.push_back(std::move(unit));
 		}
@@ -258,18 +298,24 @@ namespace {
 			return sdb::die{ next };
 		}
 
-		auto& abbrev_table = cu.abbrev_table();
-		auto& abbrev = abbrev_table.at(abbrev_code);
+		auto abbrev = cu.abbrev_table().find(abbrev_code);
+		if (!abbrev) sdb::error::send("Unknown DWARF abbreviation code");
 
-		std::vector<const std::byte*> attr_locs;
-		attr_locs.reserve(abbrev.attr_specs.size());
-		for (auto& attr : abbrev.attr_specs) {
-			attr_locs.push_back(cur.position());
-			cur.skip_form(attr.form);
+		auto attrs = cur.position();
+		cur += abbrev->fixed_size;
+		auto& specs = abbrev->attr_specs;
+		for (auto i = abbrev->first_variable_attr; i < specs.size();) {
+			if (specs[i].fixed_run_length) {
+				cur += specs[i].fixed_run_size;
+				i += specs[i].fixed_run_length;
+			}
+			else {
+				cur.skip_form(specs[i++].form);
+			}
 		}
 
 		auto next = cur.position();
-		return sdb::die(pos, &cu, &abbrev, std::move(attr_locs), next);
+		return sdb::die(pos, &cu, abbrev, attrs, next);
 	}
 
 	sdb::line_table::file parse_line_table_file(cursor& cur,
@@ -294,7 +340,7 @@ namespace {
 
 	std::unique_ptr<sdb::line_table>
 		parse_line_table(const sdb::compile_unit& cu) {
-		auto section = cu.dwarf_info()->elf_file()->get_section_contents(".debug_line");
+		auto section = cu.dwarf_info()->debug_line();
 		if (!cu.root().contains(DW_AT_stmt_list)) return nullptr;
 		auto offset = cu.root()[DW_AT_stmt_list].as_section_offset();
 		cursor cur({ section.begin() + offset, section.end() });
@@ -400,15 +446,12 @@ namespace {
 	void execute_cfi_instruction(
 		const sdb::elf& elf,
 		const sdb::call_frame_information::frame_description_entry& fde,
-		unwind_context& ctx,
-		sdb::file_addr pc
+		cfi_program& program
 	) {
+		using kind = register_rule::kind;
 		auto& cie = *fde.cie;
-		auto& cur = ctx.cur;
-
-		auto text_section_start = *elf.get_section_start_addr(".text");
-		auto plt_start = elf.get_section_start_addr(".got.plt")
-			.value_or(sdb::file_addr{});
+		auto& cur = program.cur;
+		auto& row = program.row;
 
 		auto opcode = cur.u8();
 		auto primary_opcde = opcode & 0xc0;
@@ -418,64 +461,68 @@ namespace {
 			switch (primary_opcde)
 			{
 			case DW_CFA_advance_loc:
-				ctx.location += extended_opcode * cie.code_alignment_factor;
+				program.advance_to(
+					row.location + extended_opcode * cie.code_alignment_factor);
 				break;
 			case DW_CFA_offset: {
 				auto offset = 
 					static_cast<std::int64_t>(cur.uleb128()) * cie.data_alignment_factor;
-				ctx.register_rules.emplace(extended_opcode, offset_rule{offset});
+				program.set_rule(extended_opcode, kind::offset, offset);
 				break;
 			}
 			case DW_CFA_restore:
-				ctx.register_rules.emplace(
-					extended_opcode, ctx.cie_register_rules.at(extended_opcode)
-				);
+				program.restore_rule(extended_opcode);
 				break;
 			}
 		} else if (extended_opcode) {
 			switch (extended_opcode) 
 			{
             case DW_CFA_set_loc: {
+                auto text_section_start = *elf.get_section_start_addr(".text");
+                auto plt_start = elf.get_section_start_addr(".got.plt")
+                    .value_or(sdb::file_addr{});
                 auto current_offset = elf.data_pointer_as_file_offset(cur.position());
                 auto loc = parse_eh_frame_pointer(
                     elf, cur, cie.fde_pointer_encoding,
                     current_offset.off(), text_section_start.addr(),
                     plt_start.addr(), fde.initial_location.addr());
-                ctx.location = sdb::file_addr{ elf, loc };
+                program.advance_to(loc);
                 break;
             }
             case DW_CFA_advance_loc1:
-                ctx.location += cur.u8() * cie.code_alignment_factor;
+                program.advance_to(row.location + cur.u8() * cie.code_alignment_factor);
                 break;
             case DW_CFA_advance_loc2:
-                ctx.location += cur.u16() * cie.code_alignment_factor;
+                program.advance_to(row.location + cur.u16() * cie.code_alignment_factor);
                 break;
             case DW_CFA_advance_loc4:
-                ctx.location += cur.u32() * cie.code_alignment_factor;
+                program.advance_to(row.location + cur.u32() * cie.code_alignment_factor);
                 break;
             case DW_CFA_def_cfa:
-                ctx.cfa_rule = cfa_register_rule{
-                  static_cast<std::uint32_t>(cur.uleb128()),
-                  static_cast<std::uint32_t>(cur.uleb128())
-                };
+                row.cfa_register = static_cast<std::uint32_t>(cur.uleb128());
+                row.cfa_offset = static_cast<std::int64_t>(cur.uleb128());
+                row.cfa_expression = {};
                 break;
             case DW_CFA_def_cfa_sf:
-                ctx.cfa_rule = cfa_register_rule{
-                    static_cast<std::uint32_t>(cur.uleb128()),
-                    cur.sleb128() * cie.data_alignment_factor
-                };
+                row.cfa_register = static_cast<std::uint32_t>(cur.uleb128());
+                row.cfa_offset = cur.sleb128() * cie.data_alignment_factor;
+                row.cfa_expression = {};
                 break;
             case DW_CFA_def_cfa_register:
-                ctx.cfa_rule.reg = cur.uleb128();
+                row.cfa_register = cur.uleb128();
+                row.cfa_expression = {};
                 break;
             case DW_CFA_def_cfa_offset:
-                ctx.cfa_rule.offset = cur.uleb128();
+                row.cfa_offset = cur.uleb128();
                 break;
             case DW_CFA_def_cfa_offset_sf:
-				ctx.cfa_rule.offset = cur.uleb128() * cie.data_alignment_factor;
+				row.cfa_offset = cur.sleb128() * cie.data_alignment_factor;
                 break;
             case DW_CFA_def_cfa_expression: {
-                sdb::error::send("DWARF expressions not yet implemeneted");
+                auto length = cur.uleb128();
+                row.cfa_expression = { cur.position(), length };
+                cur += length;
+                break;
             }
             case DW_CFA_expression: {
                 sdb::error::send("DWARF expressions not yet implemeneted");
@@ -484,110 +531,238 @@ namespace {
 				sdb::error::send("DWARF expressions not yet implemeneted");
             }
             case DW_CFA_undefined:
-                ctx.register_rules.emplace(cur.uleb128(), undefined_rule{});
+                program.set_rule(cur.uleb128(), kind::undefined);
                 break;
             case DW_CFA_same_value:
-                ctx.register_rules.emplace(cur.uleb128(), same_rule{});
+                program.set_rule(cur.uleb128(), kind::same);
                 break;
             case DW_CFA_offset_extended: {
                 auto reg = cur.uleb128();
                 auto offset = static_cast<std::int64_t>(
                     cur.uleb128()) * cie.data_alignment_factor;
-                ctx.register_rules.emplace(reg, offset_rule{ offset });
+                program.set_rule(reg, kind::offset, offset);
                 break;
             }
             case DW_CFA_offset_extended_sf: {
                 auto reg = cur.uleb128();
                 auto offset = cur.sleb128() * cie.data_alignment_factor;
-                ctx.register_rules.emplace(reg, offset_rule{ offset });
+                program.set_rule(reg, kind::offset, offset);
                 break;
             }
             case DW_CFA_val_offset: {
                 auto reg = cur.uleb128();
                 auto offset = static_cast<std::int64_t>(
                     cur.uleb128()) * cie.data_alignment_factor;
-                ctx.register_rules.emplace(reg, val_offset_rule{ offset });
+                program.set_rule(reg, kind::val_offset, offset);
                 break;
             }
             case DW_CFA_val_offset_sf: {
                 auto reg = cur.uleb128();
                 auto offset = cur.sleb128() * cie.data_alignment_factor;
-                ctx.register_rules.emplace(reg, val_offset_rule{ offset });
+                program.set_rule(reg, kind::val_offset, offset);
                 break;
             }
             case DW_CFA_register: {
                 auto reg = cur.uleb128();
-                ctx.register_rules.emplace(
-                    reg, register_rule{ static_cast<std::uint32_t>(cur.uleb128()) });
+                program.set_rule(reg, kind::reg, cur.uleb128());
                 break;
             }
-            case DW_CFA_restore_extended: {
-                auto reg = cur.uleb128();
-                ctx.register_rules.emplace(reg, ctx.cie_register_rules.at(reg));
+            case DW_CFA_restore_extended:
+                program.restore_rule(cur.uleb128());
                 break;
-            }
             case DW_CFA_remember_state:
-                ctx.rule_stack.push_back({ ctx.register_rules, ctx.cfa_rule });
+                program.rule_stack.push_back(row);
                 break;
-            case DW_CFA_restore_state:
-                ctx.register_rules = ctx.rule_stack.back().first;
-                ctx.cfa_rule = ctx.rule_stack.back().second;
-                ctx.rule_stack.pop_back();
+            case DW_CFA_restore_state: {
+                auto location = row.location;
+                row = program.rule_stack.back();
+                row.location = location;
+                program.rule_stack.pop_back();
                 break;
+            }
+			}
+		}
+	}
+
+	// runs a DWARF expression with an empty stack and returns the value
+	// left on top. only the operations that compute addresses from
+	// registers, constants and memory are supported
+	template <class ReadRegister, class ReadWord>
+	std::uint64_t evaluate_expression(sdb::span<const std::byte> expr,
+		ReadRegister read_register, ReadWord read_u64) {
+		std::vector<std::uint64_t> stack;
+		auto pop = [&] {
+			if (stack.empty()) sdb::error::send("DWARF expression stack underflow");
+			auto value = stack.back();
+			stack.pop_back();
+			return value;
+		};
+
+		cursor cur(expr);
+		while (!cur.finished()) {
+			auto op = cur.u8();
+			if (op >= DW_OP_lit0 and op <= DW_OP_lit31) {
+				stack.push_back(op - DW_OP_lit0);
+				continue;
+			}
+			if (op >= DW_OP_breg0 and op <= DW_OP_breg31) {
+				stack.push_back(read_register(op - DW_OP_breg0) + cur.sleb128());
+				continue;
+			}
+
+			switch (op) {
+			case DW_OP_nop: break;
+			case DW_OP_bregx: {
+				auto reg = cur.uleb128();
+				stack.push_back(read_register(reg) + cur.sleb128());
+				break;
+			}
+			case DW_OP_const1u: stack.push_back(cur.u8()); break;
+			case DW_OP_const1s: stack.push_back(cur.s8()); break;
+			case DW_OP_const2u: stack.push_back(cur.u16()); break;
+			case DW_OP_const2s: stack.push_back(cur.s16()); break;
+			case DW_OP_const4u: stack.push_back(cur.u32()); break;
+			case DW_OP_const4s: stack.push_back(cur.s32()); break;
+			case DW_OP_const8u: stack.push_back(cur.u64()); break;
+			case DW_OP_const8s: stack.push_back(cur.s64()); break;
+			case DW_OP_constu: stack.push_back(cur.uleb128()); break;
+			case DW_OP_consts: stack.push_back(cur.sleb128()); break;
+			case DW_OP_dup: {
+				auto value = pop();
+				stack.insert(stack.end(), { value, value });
+				break;
+			}
+			case DW_OP_drop: pop(); break;
+			case DW_OP_swap: {
+				auto top = pop();
+				auto second = pop();
+				stack.insert(stack.end(), { top, second });
+				break;
+			}
+			case DW_OP_over: {
+				auto top = pop();
+				auto second = pop();
+				stack.insert(stack.end(), { second, top, second });
+				break;
+			}
+			case DW_OP_deref:
+				stack.push_back(read_u64(sdb::virt_addr{ pop() }));
+				break;
+			case DW_OP_plus_uconst: stack.push_back(pop() + cur.uleb128()); break;
+			case DW_OP_neg: stack.push_back(-pop()); break;
+			case DW_OP_not: stack.push_back(~pop()); break;
+			case DW_OP_abs: {
+				auto value = static_cast<std::int64_t>(pop());
+				stack.push_back(value < 0 ? -value : value);
+				break;
+			}
+			default: {
+				auto rhs = pop();
+				auto lhs = pop();
+				auto signed_lhs = static_cast<std::int64_t>(lhs);
+				auto signed_rhs = static_cast<std::int64_t>(rhs);
+				switch (op) {
+				case DW_OP_plus: stack.push_back(lhs + rhs); break;
+				case DW_OP_minus: stack.push_back(lhs - rhs); break;
+				case DW_OP_mul: stack.push_back(lhs * rhs); break;
+				case DW_OP_and: stack.push_back(lhs & rhs); break;
+				case DW_OP_or: stack.push_back(lhs | rhs); break;
+				case DW_OP_xor: stack.push_back(lhs ^ rhs); break;
+				case DW_OP_shl: stack.push_back(rhs < 64 ? lhs << rhs : 0); break;
+				case DW_OP_shr: stack.push_back(rhs < 64 ? lhs >> rhs : 0); break;
+				case DW_OP_shra: stack.push_back(signed_lhs >> std::min<std::uint64_t>(rhs, 63)); break;
+				// comparisons are signed
+				case DW_OP_lt: stack.push_back(signed_lhs < signed_rhs); break;
+				case DW_OP_le: stack.push_back(signed_lhs <= signed_rhs); break;
+				case DW_OP_gt: stack.push_back(signed_lhs > signed_rhs); break;
+				case DW_OP_ge: stack.push_back(signed_lhs >= signed_rhs); break;
+				case DW_OP_eq: stack.push_back(signed_lhs == signed_rhs); break;
+				case DW_OP_ne: stack.push_back(signed_lhs != signed_rhs); break;
+				default: sdb::error::send("Unsupported DWARF expression operation");
+				}
+			}
 			}
 		}
+		return pop();
 	}
 
+	// applies the row's rules to the callee's registers, reading saved
+	// ones through read_u64. register lookups by DWARF number go through
+	// a table built on first use
+	template <class ReadWord>
 	sdb::registers execute_unwind_rules(
-		unwind_context& ctx, sdb::registers& old_regs,
-		const sdb::process& proc) {
+		const unwind_row& row, sdb::registers& old_regs,
+		ReadWord read_u64) {
+		using kind = register_rule::kind;
+		static const auto register_infos = [] {
+			std::array<const sdb::register_info*,
+				sdb::call_frame_information::n_unwind_registers> infos;
+			for (std::size_t i = 0; i < infos.size(); ++i) {
+				infos[i] = &sdb::register_info_by_dwarf(i);
+			}
+			return infos;
+		}();
+		auto info_for = [&](std::uint64_t reg) -> const sdb::register_info& {
+			return reg < register_infos.size() ?
+				*register_infos[reg] : sdb::register_info_by_dwarf(reg);
+		};
+
 		auto unwound_regs = old_regs;
 
-		auto cfa_reg_info = sdb::register_info_by_dwarf(ctx.cfa_rule.reg);
-		auto cfa = std::get<std::uint64_t>(old_regs.read(cfa_reg_info)) +
-			ctx.cfa_rule.offset;
+		auto read_register = [&](std::uint64_t reg) {
+			return std::get<std::uint64_t>(old_regs.read(info_for(reg)));
+		};
+		auto cfa = row.cfa_expression.size() != 0 ?
+			evaluate_expression(row.cfa_expression, read_register, read_u64) :
+			read_register(row.cfa_register) + row.cfa_offset;
 		old_regs.set_cfa(sdb::virt_addr{ cfa });
 		unwound_regs.write_by_id(sdb::register_id::rsp, { cfa }, false);
 
-		for (auto [reg, rule] : ctx.register_rules) {
-			auto reg_info = sdb::register_info_by_dwarf(reg);
-
-			if (auto undef = std::get_if<undefined_rule>(&rule)) {
+		for (std::size_t reg = 0; reg < row.rules.size(); ++reg) {
+			auto& rule = row.rules[reg];
+			auto& reg_info = *register_infos[reg];
+			switch (rule.type) {
+			case kind::same:
+				break;
+			case kind::undefined:
 				unwound_regs.undefine(reg_info.id);
-			}
-			else if (auto same = std::get_if<same_rule>(&rule)) {
-				// Do nothing
-			}
-			else if (auto reg = std::get_if<register_rule>(&rule)) {
-				auto other_reg = sdb::register_info_by_dwarf(reg->reg);
-				unwound_regs.write(reg_info, old_regs.read(other_reg), false);
-			}
-			else if (auto offset = std::get_if<offset_rule>(&rule)) {
-				auto addr = sdb::virt_addr{ cfa + offset->offset };
-				auto value = sdb::from_bytes<std::uint64_t>(
-					proc.read_memory(addr, 8).data());
+				break;
+			case kind::reg:
+				unwound_regs.write(reg_info, old_regs.read(info_for(rule.value)), false);
+				break;
+			case kind::offset: {
+				auto addr = sdb::virt_addr{ cfa + rule.value };
+				auto value = read_u64(addr);
 				unwound_regs.write(reg_info, { value }, false);
+				break;
 			}
-			else if (auto val_offset = std::get_if<val_offset_rule>(&rule)) {
-				auto addr = cfa + val_offset->offset;
-				unwound_regs.write(reg_info, { addr }, false);
+			case kind::val_offset:
+				unwound_regs.write(reg_info, { cfa + rule.value }, false);
+				break;
 			}
 		}
 		return unwound_regs;
 	}
 
 	sdb::call_frame_information::frame_description_entry parse_fde(
-		const sdb::call_frame_information& cfi, cursor cur 
+		const sdb::call_frame_information& cfi, cursor cur,
+		bool debug_frame = false
 	)  {
 		auto start = cur.position();
 		auto length = cur.u32() + 4;
 
+		// .eh_frame's CIE pointer is relative to itself, .debug_frame's
+		// to the start of the section
 		auto elf = cfi.dwarf_info().elf_file();
-		auto current_offset = elf->data_pointer_as_file_offset(cur.position());
-		sdb::file_offset cie_offset{*elf, current_offset.off() - cur.s32()};
+		auto section_file = debug_frame ? cfi.dwarf_info().debug_file() : elf;
+		auto current_offset = section_file->data_pointer_as_file_offset(cur.position());
+		auto section_offset = debug_frame ? section_file->data_pointer_as_file_offset(
+			cfi.dwarf_info().debug_frame().begin()).off() : 0;
+		sdb::file_offset cie_offset{*section_file, debug_frame ?
+			section_offset + cur.u32() : current_offset.off() - cur.s32()};
 		auto& cie = cfi.get_cie(cie_offset);
 
-		current_offset = elf->data_pointer_as_file_offset(cur.position());
+		current_offset = section_file->data_pointer_as_file_offset(cur.position());
 		auto text_section_start = elf->get_section_start_addr(".text")
 			.value_or(sdb::file_addr{});
 		auto initial_location_addr = parse_eh_frame_pointer(
@@ -662,8 +837,13 @@ namespace {
 				fde_has_augmentation, fde_pointer_encoding, instructions};
 	}
 
-	sdb::call_frame_information::eh_hdr parse_eh_hdr(sdb::dwarf& dwarf) {
+	sdb::call_frame_information::eh_hdr parse_eh_hdr(const sdb::dwarf& dwarf) {
 		auto elf = dwarf.elf_file();
+		// nothing to search, every lookup misses
+		if (!elf->get_section(".eh_frame_hdr") or !elf->get_section(".text")) {
+			return { nullptr, nullptr, 0, 0, nullptr };
+		}
+
 		auto eh_hdr_start = *elf->get_section_start_addr(".eh_frame_hdr");
 		auto text_section_start = *elf->get_section_start_addr(".text");
 
@@ -696,10 +876,23 @@ namespace {
 
 
 	std::unique_ptr<sdb::call_frame_information>
-	parse_call_frame_information(sdb::dwarf& dwarf) {
+	parse_call_frame_information(const sdb::dwarf& dwarf) {
 		auto eh_hdr = parse_eh_hdr(dwarf);
 		return std::make_unique<sdb::call_frame_information>(&dwarf, eh_hdr);
 	}
+
+	// calls f(low, high) for every address range covered by the DIE
+	template <class F>
+	void for_each_range(const sdb::die& d, F f) {
+		if (d.contains(DW_AT_ranges)) {
+			for (auto& range : d[DW_AT_ranges].as_range_list()) {
+				f(range.low.addr(), range.high.addr());
+			}
+		}
+		else if (d.contains(DW_AT_low_pc) and d.contains(DW_AT_high_pc)) {
+			f(d.low_pc().addr(), d.high_pc().addr());
+		}
+	}
 }
 
 sdb::registers sdb::call_frame_information::unwind(
@@ -707,53 +900,160 @@ sdb::registers sdb::call_frame_information::unwind(
 	file_addr pc,
 	registers& regs
 ) const {
-	auto fde_start = eh_hdr_[pc]; 
-	auto eh_frame_end = dwarf_->elf_file()->get_section_contents(".eh_frame").end();
+	return execute_unwind_rules(row_at(pc), regs, [&](auto addr) {
+		return proc.read_memory_as<std::uint64_t>(addr);
+		});
+}
 
-	cursor curr({ fde_start, eh_frame_end });
-	auto fde = parse_fde(*this, curr);
-	if (pc < fde.initial_location or pc >= fde.initial_location + fde.address_range) {
-		sdb::error::send("No unwind information at pc");
-	}
+sdb::registers sdb::call_frame_information::unwind(
+	memory_snapshot& stack,
+	file_addr pc,
+	registers& regs
+) const {
+	return execute_unwind_rules(row_at(pc), regs, [&](auto addr) {
+		return stack.read_u64(addr);
+		});
+}
 
-	unwind_context ctx{};
-	ctx.cur = cursor(fde.cie->instructions);
-	while (!ctx.cur.finished()) {
-		execute_cfi_instruction(*dwarf_->elf_file(), fde, ctx, pc);
-	}
+bool sdb::call_frame_information::covers(file_addr pc) const {
+	return find_plan(pc) != nullptr;
+}
 
-	ctx.cie_register_rules = ctx.register_rules;
-	ctx.cur = cursor(fde.instructions);
-	ctx.location = fde.initial_location;
+const sdb::call_frame_information::unwind_row&
+sdb::call_frame_information::row_at(file_addr pc) const {
+	auto& plan = plan_at(pc);
+	auto row = std::upper_bound(plan.rows.begin(), plan.rows.end(), pc.addr(),
+		[](auto addr, auto& row) { return addr < row.location; });
+	if (row != plan.rows.begin()) --row;
+	return *row;
+}
+
+const sdb::call_frame_information::unwind_plan&
+sdb::call_frame_information::plan_at(file_addr pc) const {
+	if (auto plan = find_plan(pc)) return *plan;
+	sdb::error::send("No unwind information at pc");
+}
 
-	while (!ctx.cur.finished() and ctx.location <= pc) {
-		execute_cfi_instruction(*dwarf_->elf_file(), fde, ctx, pc);
+const sdb::call_frame_information::unwind_plan*
+sdb::call_frame_information::find_plan(file_addr pc) const {
+	if (pc.elf_file() != dwarf_->elf_file()) return nullptr;
+	auto covers = [&](const unwind_plan& plan) {
+		return plan.low <= pc.addr() and pc.addr() < plan.high;
+	};
+
+	std::lock_guard lock(plans_mutex_);
+	if (eh_hdr_.count != 0 and pc.addr() >= eh_hdr_.address_at(0)) {
+		auto index = eh_hdr_.find(pc);
+		auto& plan = plan_for(index, eh_hdr_.fde_at(index), false);
+		if (covers(plan)) return &plan;
 	}
-	
-	return execute_unwind_rules(ctx, regs, proc);
+
+	if (!fde_table_built_) build_fde_table();
+	auto it = std::upper_bound(fde_table_.begin(), fde_table_.end(), pc.addr(),
+		[](auto addr, auto& entry) { return addr < entry.low; });
+	if (it == fde_table_.begin()) return nullptr;
+	--it;
+
+	auto index = eh_hdr_.count + (it - fde_table_.begin());
+	auto& plan = plan_for(index, it->fde, it->debug_frame);
+	return covers(plan) ? &plan : nullptr;
 }
 
+void sdb::call_frame_information::build_fde_table() const {
+	// walks every record of a section, keeping the FDEs
+	auto scan = [&](span<const std::byte> section, bool debug_frame) {
+		cursor cur(section);
+		while (!cur.finished()) {
+			auto start = cur.position();
+			auto length = cur.u32();
+			// terminator, or 64-bit DWARF which the rest doesn't handle
+			if (length == 0 or length == 0xffffffff) break;
+			if (start + 4 + length > section.end()) break;
+
+			auto id = cur.u32();
+			auto is_cie = debug_frame ? id == 0xffffffff : id == 0;
+			if (!is_cie) {
+				auto fde = parse_fde(*this, cursor({ start, section.end() }), debug_frame);
+				// functions the linker threw away keep their FDEs at 0
+				if (fde.address_range != 0 and fde.initial_location.addr() != 0) {
+					fde_table_.push_back({ fde.initial_location.addr(), start, debug_frame });
+				}
+			}
+			cur = cursor({ start + 4 + length, section.end() });
+		}
+	};
+
+	if (eh_hdr_.count == 0) scan(dwarf_->eh_frame(), false);
+	scan(dwarf_->debug_frame(), true);
+	std::stable_sort(fde_table_.begin(), fde_table_.end(),
+		[](auto& lhs, auto& rhs) { return lhs.low < rhs.low; });
+	fde_table_built_ = true;
+}
 
+const sdb::call_frame_information::unwind_plan&
+sdb::call_frame_information::plan_for(
+	std::size_t index, const std::byte* fde_start, bool debug_frame) const {
+	if (index >= plans_.size()) plans_.resize(index + 1);
+	auto& plan = plans_[index];
+	if (plan) return *plan;
+
+	auto section = debug_frame ? dwarf_->debug_frame() : dwarf_->eh_frame();
+	cursor curr({ fde_start, section.end() });
+	auto fde = parse_fde(*this, curr, debug_frame);
+	auto elf = dwarf_->elf_file();
+
+	cfi_program program;
+	program.row.location = fde.initial_location.addr();
+	program.cur = cursor(fde.cie->instructions);
+	while (!program.cur.finished()) {
+		execute_cfi_instruction(*elf, fde, program);
+	}
+
+	program.row.location = fde.initial_location.addr();
+	program.initial_row = program.row;
+	program.rows.clear();
+	program.cur = cursor(fde.instructions);
+	while (!program.cur.finished()) {
+		execute_cfi_instruction(*elf, fde, program);
+	}
+	program.rows.push_back(program.row);
+
+	plan = std::make_unique<unwind_plan>(unwind_plan{
+		fde.initial_location.addr(),
+		fde.initial_location.addr() + fde.address_range,
+		std::move(program.rows) });
+	return *plan;
+}
 
 const std::byte* sdb::call_frame_information::eh_hdr::operator[](file_addr address) const {
-	auto elf = address.elf_file();
+	return fde_at(find(address));
+}
+
+std::uint64_t sdb::call_frame_information::eh_hdr::address_at(std::size_t index) const {
+	auto elf = parent->dwarf_info().elf_file();
 	auto text_section_start = *elf->get_section_start_addr(".text");
 	auto encoding_size = eh_frame_pointer_encoding_size(encoding);
 	auto row_size = encoding_size * 2;
 
+	cursor cur({search_table + index * row_size, 
+				search_table + count * row_size});
+
+	auto current_offset = elf->data_pointer_as_file_offset(cur.position());
+	auto eh_hdr_offset = elf->data_pointer_as_file_offset(start);
+	return parse_eh_frame_pointer(*elf, cur, encoding, current_offset.off(),
+					text_section_start.addr(), eh_hdr_offset.off(), 0);
+}
+
+std::size_t sdb::call_frame_information::eh_hdr::find(file_addr address) const {
+	if (count == 0)
+		sdb::error::send("Address not found in eh_hdr");
+
 	// binary search
 	std::size_t low = 0;
 	std::size_t high = count - 1;
 	while (low <= high) {
 		std::size_t mid = (low + high) / 2;
-		cursor cur({search_table + mid * row_size, 
-					search_table + count * row_size});
-
-		auto current_offset = elf->data_pointer_as_file_offset(cur.position());
-		auto eh_hdr_offset = elf->data_pointer_as_file_offset(start);
-		auto entry_address = 
-			parse_eh_frame_pointer(*elf, cur, encoding, current_offset.off(),
-						text_section_start.addr(), eh_hdr_offset.off(), 0);
+		auto entry_address = address_at(mid);
 		
 		if (entry_address < address.addr()) {
 			low = mid + 1;
@@ -768,9 +1068,17 @@ const std::byte* sdb::call_frame_information::eh_hdr::operator[](file_addr addre
 			break;
 		}
 	}
+	return high;
+}
+
+const std::byte* sdb::call_frame_information::eh_hdr::fde_at(std::size_t index) const {
+	auto elf = parent->dwarf_info().elf_file();
+	auto text_section_start = *elf->get_section_start_addr(".text");
+	auto encoding_size = eh_frame_pointer_encoding_size(encoding);
+	auto row_size = encoding_size * 2;
 
 	// return fde entry as data pointer
-	cursor cur({ search_table + high * row_size + encoding_size,
+	cursor cur({ search_table + index * row_size + encoding_size,
 				search_table + count * row_size });
 
 	auto current_offset = elf->data_pointer_as_file_offset(cur.position());
@@ -785,34 +1093,446 @@ const std::byte* sdb::call_frame_information::eh_hdr::operator[](file_addr addre
 
 const sdb::call_frame_information::common_information_entry& 
 sdb::call_frame_information::get_cie(file_offset at) const {
-	auto offset = at.off();
-	if (cie_map_.count(offset)) {
-		return cie_map_.at(offset);
+	auto data = at.elf_file()->file_offset_as_data_pointer(at);
+	std::lock_guard lock(cie_mutex_);
+	if (cie_map_.count(data)) {
+		return cie_map_.at(data);
 	}
 
-	auto section = at.elf_file()->get_section_contents(".eh_frame");
-	cursor cur({ at.elf_file()->file_offset_as_data_pointer(at), section.end()});
+	auto debug_frame = dwarf_->debug_frame();
+	auto in_debug_frame = debug_frame.begin() <= data and data < debug_frame.end();
+	cursor cur({ data,
+		in_debug_frame ? debug_frame.end() : dwarf_->eh_frame().end() });
 	auto cie = parse_cie(cur);
-	cie_map_.emplace(offset, cie);
-	return cie_map_.at(offset);
+	cie_map_.emplace(data, cie);
+	return cie_map_.at(data);
 }
 
-const std::unordered_map<std::uint64_t, sdb::abbrev>&
-sdb::dwarf::get_abbrev_table(std::size_t offset) {
+// name table emitted by the compiler or linker
+class sdb::name_index {
+public:
+	virtual ~name_index() = default;
+	// .debug_info offsets of the units the table lists the name under
+	virtual std::vector<std::size_t> unit_offsets(std::string_view name) const = 0;
+};
+
+namespace {
+	std::uint64_t read_form_value(cursor& cur, std::uint64_t form) {
+		switch (form) {
+		case DW_FORM_flag_present: return 1;
+		case DW_FORM_data1:
+		case DW_FORM_ref1:
+		case DW_FORM_flag: return cur.u8();
+		case DW_FORM_data2:
+		case DW_FORM_ref2: return cur.u16();
+		case DW_FORM_data4:
+		case DW_FORM_ref4: return cur.u32();
+		case DW_FORM_data8:
+		case DW_FORM_ref8:
+		case DW_FORM_ref_sig8: return cur.u64();
+		case DW_FORM_udata:
+		case DW_FORM_ref_udata: return cur.uleb128();
+		default:
+			cur.skip_form(form);
+			return 0;
+		}
+	}
+
+	// gdb's .gdb_index, as written by gold, lld and gdb-add-index
+	class gdb_index final : public sdb::name_index {
+	public:
+		static std::unique_ptr<gdb_index> parse(sdb::span<const std::byte> data) {
+			if (data.size() < 6 * sizeof(std::uint32_t)) return nullptr;
+
+			cursor cur(data);
+			auto version = cur.u32();
+			// older versions hash names differently
+			if (version != 7 and version != 8) return nullptr;
+			auto cu_list = cur.u32();
+			auto types_list = cur.u32();
+			cur.u32(); // address area
+			auto symbol_table = cur.u32();
+			auto constant_pool = cur.u32();
+
+			auto n_slots = (constant_pool - symbol_table) / 8;
+			if (cu_list > types_list or symbol_table > constant_pool or
+				constant_pool > data.size() or
+				n_slots == 0 or (n_slots & (n_slots - 1)) != 0) {
+				return nullptr;
+			}
+
+			auto index = std::make_unique<gdb_index>();
+			index->data_ = data;
+			index->cu_list_ = data.begin() + cu_list;
+			index->n_cus_ = (types_list - cu_list) / 16;
+			index->symbol_table_ = data.begin() + symbol_table;
+			index->n_slots_ = n_slots;
+			index->constant_pool_ = data.begin() + constant_pool;
+			return index;
+		}
+
+		std::vector<std::size_t> unit_offsets(std::string_view name) const override {
+			std::uint32_t hash = 0;
+			for (auto c : name) {
+				hash = hash * 67 + std::tolower(static_cast<unsigned char>(c)) - 113;
+			}
+
+			auto mask = n_slots_ - 1;
+			auto slot = hash & mask;
+			auto step = ((hash * 17) & mask) | 1;
+
+			std::vector<std::size_t> offsets;
+			for (std::size_t probes = 0; probes < n_slots_; ++probes) {
+				cursor cur({ symbol_table_ + slot * 8, data_.end() });
+				auto name_offset = cur.u32();
+				auto vector_offset = cur.u32();
+				if (name_offset == 0 and vector_offset == 0) break;
+
+				cursor name_cur({ constant_pool_ + name_offset, data_.end() });
+				if (name_cur.string() == name) {
+					cursor vec({ constant_pool_ + vector_offset, data_.end() });
+					auto count = vec.u32();
+					for (std::uint32_t i = 0; i < count; ++i) {
+						auto value = vec.u32();
+						auto cu_index = value & 0xffffff;
+						// 0 means the producer didn't record the kind
+						auto kind = (value >> 28) & 0x7;
+						if ((kind == 0 or kind == function_kind) and cu_index < n_cus_) {
+							cursor cu_cur({ cu_list_ + cu_index * 16, data_.end() });
+							offsets.push_back(cu_cur.u64());
+						}
+					}
+					break;
+				}
+				slot = (slot + step) & mask;
+			}
+			return offsets;
+		}
+
+	private:
+		static constexpr std::uint32_t function_kind = 3;
+
+		sdb::span<const std::byte> data_;
+		const std::byte* cu_list_;
+		std::size_t n_cus_;
+		const std::byte* symbol_table_;
+		std::size_t n_slots_;
+		const std::byte* constant_pool_;
+	};
+
+	// DWARF 5 .debug_names. a linker that doesn't merge them leaves one
+	// table per input object in the section
+	class debug_names final : public sdb::name_index {
+	public:
+		static std::unique_ptr<debug_names> parse(
+			sdb::span<const std::byte> data, sdb::span<const std::byte> debug_str) {
+			auto index = std::make_unique<debug_names>();
+			index->debug_str_ = debug_str;
+
+			cursor cur(data);
+			while (!cur.finished()) {
+				auto length = cur.u32();
+				if (length == 0xffffffff or
+					length > static_cast<std::size_t>(data.end() - cur.position())) {
+					return nullptr;
+				}
+				auto end = cur.position() + length;
+				if (cur.u16() != 5) return nullptr;
+				cur.u16(); // padding
+
+				table t;
+				t.end = end;
+				t.cu_count = cur.u32();
+				auto local_tu_count = cur.u32();
+				auto foreign_tu_count = cur.u32();
+				t.bucket_count = cur.u32();
+				t.name_count = cur.u32();
+				auto abbrev_table_size = cur.u32();
+				auto augmentation_size = cur.u32();
+				cur += (augmentation_size + 3) & ~3u;
+
+				t.cu_offsets = cur.position();
+				cur += 4 * t.cu_count + 4 * local_tu_count + 8 * foreign_tu_count;
+				t.buckets = cur.position();
+				cur += 4 * t.bucket_count;
+				t.hashes = cur.position();
+				if (t.bucket_count != 0) cur += 4 * t.name_count;
+				t.string_offsets = cur.position();
+				cur += 4 * t.name_count;
+				t.entry_offsets = cur.position();
+				cur += 4 * t.name_count;
+
+				auto abbrevs_end = cur.position() + abbrev_table_size;
+				if (abbrevs_end > end) return nullptr;
+				while (cur.position() < abbrevs_end) {
+					auto code = cur.uleb128();
+					if (code == 0) break;
+					auto& abbrev = t.abbrevs[code];
+					abbrev.tag = cur.uleb128();
+					while (true) {
+						auto idx = cur.uleb128();
+						auto form = cur.uleb128();
+						if (idx == 0 and form == 0) break;
+						abbrev.attrs.push_back({ idx, form });
+					}
+				}
+				t.entry_pool = abbrevs_end;
+
+				index->tables_.push_back(std::move(t));
+				cur = cursor({ end, data.end() });
+			}
+			if (index->tables_.empty()) return nullptr;
+			return index;
+		}
+
+		std::vector<std::size_t> unit_offsets(std::string_view name) const override {
+			std::uint32_t hash = 5381;
+			for (auto c : name) {
+				hash = hash * 33 + std::tolower(static_cast<unsigned char>(c));
+			}
+
+			std::vector<std::size_t> offsets;
+			for (auto& t : tables_) {
+				auto visit = [&](std::size_t i) {
+					auto string_offset = read_u32(t.string_offsets, i);
+					cursor name_cur({ debug_str_.begin() + string_offset, debug_str_.end() });
+					if (name_cur.string() == name) {
+						read_entries(t, read_u32(t.entry_offsets, i), offsets);
+					}
+				};
+
+				if (t.bucket_count == 0) {
+					for (std::size_t i = 0; i < t.name_count; ++i) visit(i);
+					continue;
+				}
+
+				auto bucket = hash % t.bucket_count;
+				auto first = read_u32(t.buckets, bucket);
+				if (first == 0) continue;
+				for (std::size_t i = first - 1; i < t.name_count; ++i) {
+					auto entry_hash = read_u32(t.hashes, i);
+					if (entry_hash % t.bucket_count != bucket) break;
+					if (entry_hash == hash) visit(i);
+				}
+			}
+			return offsets;
+		}
+
+	private:
+		struct abbrev {
+			std::uint64_t tag;
+			std::vector<std::pair<std::uint64_t, std::uint64_t>> attrs;
+		};
+		struct table {
+			const std::byte* end;
+			std::uint32_t cu_count;
+			std::uint32_t bucket_count;
+			std::uint32_t name_count;
+			const std::byte* cu_offsets;
+			const std::byte* buckets;
+			const std::byte* hashes;
+			const std::byte* string_offsets;
+			const std::byte* entry_offsets;
+			const std::byte* entry_pool;
+			std::unordered_map<std::uint64_t, abbrev> abbrevs;
+		};
+
+		static std::uint32_t read_u32(const std::byte* array, std::size_t i) {
+			return sdb::from_bytes<std::uint32_t>(array + 4 * i);
+		}
+
+		void read_entries(const table& t, std::uint32_t offset,
+			std::vector<std::size_t>& offsets) const {
+			cursor cur({ t.entry_pool + offset, t.end });
+			while (!cur.finished()) {
+				auto code = cur.uleb128();
+				if (code == 0) break;
+				auto it = t.abbrevs.find(code);
+				if (it == t.abbrevs.end()) break;
+
+				// a table covering a single unit can leave the unit implicit
+				std::optional<std::uint64_t> cu_index;
+				if (t.cu_count == 1) cu_index = 0;
+				for (auto [idx, form] : it->second.attrs) {
+					auto value = read_form_value(cur, form);
+					if (idx == DW_IDX_compile_unit) cu_index = value;
+				}
+
+				auto tag = it->second.tag;
+				if ((tag == DW_TAG_subprogram or tag == DW_TAG_inlined_subroutine) and
+					cu_index and *cu_index < t.cu_count) {
+					offsets.push_back(read_u32(t.cu_offsets, *cu_index));
+				}
+			}
+		}
+
+		sdb::span<const std::byte> debug_str_;
+		std::vector<table> tables_;
+	};
+
+	std::unique_ptr<sdb::name_index> parse_name_index(const sdb::elf& obj) {
+		if (auto names = obj.get_section_contents(".debug_names"); names.size()) {
+			if (auto index = debug_names::parse(
+				names, obj.get_section_contents(".debug_str"))) {
+				return index;
+			}
+		}
+		if (auto index = gdb_index::parse(obj.get_section_contents(".gdb_index"))) {
+			return index;
+		}
+		return nullptr;
+	}
+}
+
+sdb::abbrev_table::abbrev_table(
+	std::vector<abbrev> abbrevs, std::vector<attr_spec> attr_specs)
+	: abbrevs_(std::move(abbrevs)), attr_specs_(std::move(attr_specs)) {
+	std::sort(abbrevs_.begin(), abbrevs_.end(),
+		[](auto& lhs, auto& rhs) { return lhs.code < rhs.code; });
+
+	dense_ = true;
+	for (std::size_t i = 0; i < abbrevs_.size(); ++i) {
+		if (abbrevs_[i].code != i + 1) dense_ = false;
+	}
+}
+
+const sdb::abbrev* sdb::abbrev_table::find(std::uint64_t code) const {
+	if (dense_) {
+		return code != 0 and code <= abbrevs_.size() ? &abbrevs_[code - 1] : nullptr;
+	}
+	auto it = std::lower_bound(abbrevs_.begin(), abbrevs_.end(), code,
+		[](auto& abbrev, auto code) { return abbrev.code < code; });
+	return it != abbrevs_.end() and it->code == code ? &*it : nullptr;
+}
+
+const sdb::abbrev_table&
+sdb::dwarf::get_abbrev_table(std::size_t offset) const {
+	std::lock_guard lock(abbrev_tables_mutex_);
 	if (!abbrev_tables_.count(offset)) {
-		abbrev_tables_.emplace(offset, parse_abbrev_table(*elf_, offset));
+		abbrev_tables_.emplace(offset, parse_abbrev_table(debug_abbrev(), offset));
 	}
 	return abbrev_tables_.at(offset);
 }
 
-const std::unordered_map<std::uint64_t, sdb::abbrev>&
+const sdb::abbrev_table&
 sdb::compile_unit::abbrev_table() const {
-	return parent_->get_abbrev_table(abbrev_offset_);
+	std::call_once(abbrev_table_once_, [this] {
+		abbrev_table_ = &parent_->get_abbrev_table(abbrev_offset_);
+		});
+	return *abbrev_table_;
+}
+
+const sdb::line_table& sdb::compile_unit::lines() const {
+	std::call_once(line_table_once_, [this] {
+		line_table_ = parse_line_table(*this);
+		});
+	return *line_table_;
+}
+
+const sdb::scope_tree& sdb::compile_unit::scopes() const {
+	std::call_once(scope_tree_once_, [this] {
+		scope_tree_ = std::make_unique<scope_tree>(*this);
+		});
+	return *scope_tree_;
+}
+
+sdb::scope_tree::scope_tree(const compile_unit& cu) {
+	add_scope(cu.root(), DW_TAG_compile_unit);
+}
+
+std::uint32_t sdb::scope_tree::add_scope(const die& d, std::uint64_t tag) {
+	auto index = static_cast<std::uint32_t>(scopes_.size());
+	scopes_.push_back({ d.position(), tag, 0, 0 });
+
+	std::vector<range> children;
+	collect_children(d, children);
+	std::sort(children.begin(), children.end(),
+		[](auto& lhs, auto& rhs) { return lhs.low < rhs.low; });
+
+	scopes_[index].first_child_range = static_cast<std::uint32_t>(ranges_.size());
+	ranges_.insert(ranges_.end(), children.begin(), children.end());
+	scopes_[index].last_child_range = static_cast<std::uint32_t>(ranges_.size());
+	return index;
+}
+
+void sdb::scope_tree::collect_children(const die& parent, std::vector<range>& out) {
+	for (auto child : parent.children()) {
+		auto tag = child.abbrev_entry()->tag;
+		bool is_scope = tag == DW_TAG_subprogram or
+			tag == DW_TAG_inlined_subroutine or tag == DW_TAG_lexical_block;
+		bool has_range = child.contains(DW_AT_ranges) or
+			(child.contains(DW_AT_low_pc) and child.contains(DW_AT_high_pc));
+
+		if (is_scope and has_range) {
+			auto index = add_scope(child, tag);
+			for_each_range(child, [&](auto low, auto high) {
+				if (low < high) out.push_back({ low, high, index });
+				});
+		}
+		else if (child.abbrev_entry()->has_children) {
+			// namespaces, classes and blocks without code of their own
+			// may still hold scopes that have some
+			collect_children(child, out);
+		}
+	}
+}
+
+std::vector<const sdb::scope_tree::scope*>
+sdb::scope_tree::scopes_containing(std::uint64_t address) const {
+	std::vector<const scope*> ret;
+	auto current = &scopes_.front();
+	while (true) {
+		auto begin = ranges_.begin() + current->first_child_range;
+		auto end = ranges_.begin() + current->last_child_range;
+		auto it = std::upper_bound(begin, end, address,
+			[](auto addr, auto& r) { return addr < r.low; });
+		if (it == begin or std::prev(it)->high <= address) break;
+
+		current = &scopes_[std::prev(it)->scope];
+		ret.push_back(current);
+	}
+	return ret;
+}
+
+sdb::dwarf::dwarf(const sdb::elf& parent)
+	: elf_(&parent) {
+}
+
+void sdb::dwarf::load_sections() const {
+	std::call_once(sections_once_, [this] {
+		// .eh_frame is loaded with the code, so it stays with it
+		debug_file_ = &elf_->debug_file();
+		debug_info_ = debug_file_->get_section_contents(".debug_info");
+		debug_abbrev_ = debug_file_->get_section_contents(".debug_abbrev");
+		debug_str_ = debug_file_->get_section_contents(".debug_str");
+		debug_line_ = debug_file_->get_section_contents(".debug_line");
+		debug_ranges_ = debug_file_->get_section_contents(".debug_ranges");
+		eh_frame_ = elf_->get_section_contents(".eh_frame");
+		debug_frame_ = debug_file_->get_section_contents(".debug_frame");
+		name_index_ = parse_name_index(*debug_file_);
+		});
 }
 
-sdb::dwarf::dwarf(const sdb::elf& parent) : elf_(&parent) {
-	compile_units_ = parse_compile_units(*this, parent);
-	cfi_ = parse_call_frame_information(*this);
+sdb::dwarf::~dwarf() {
+	if (background_index_.valid()) background_index_.wait();
+	if (index_cache_.size() != 0) {
+		munmap(const_cast<std::byte*>(index_cache_.begin()), index_cache_.size());
+	}
+}
+
+const std::vector<std::unique_ptr<sdb::compile_unit>>&
+sdb::dwarf::compile_units() const {
+	std::call_once(compile_units_once_, [this] {
+		compile_units_ = parse_compile_units(*this);
+		});
+	return compile_units_;
+}
+
+const sdb::call_frame_information& sdb::dwarf::cfi() const {
+	std::call_once(cfi_once_, [this] {
+		cfi_ = parse_call_frame_information(*this);
+		});
+	return *cfi_;
 }
 
 sdb::die sdb::compile_unit::root() const {
@@ -844,6 +1564,9 @@ sdb::die::children_range::iterator::operator++() {
 		cursor next_cur({ die_->next_, die_->cu_->data().end() });
 		die_ = parse_die(*die_->cu_, next_cur);
 	}
+	else if (die_->contains(DW_AT_sibling)) {
+		die_ = (*die_)[DW_AT_sibling].as_reference();
+	}
 	else {
 		iterator sub_children(*die_);
 		while (sub_children->abbrev_) ++sub_children;
@@ -864,11 +1587,28 @@ sdb::die::children_range sdb::die::children() const {
 	return children_range(*this);
 }
 
+const std::byte* sdb::die::attr_location(std::size_t index) const {
+	// start from the last attribute whose offset is known
+	auto& specs = abbrev_->attr_specs;
+	auto start = std::min(index, abbrev_->first_variable_attr);
+	cursor cur({ attrs_ + specs[start].offset, next_ });
+	for (auto i = start; i < index;) {
+		if (specs[i].fixed_run_length and i + specs[i].fixed_run_length <= index) {
+			cur += specs[i].fixed_run_size;
+			i += specs[i].fixed_run_length;
+		}
+		else {
+			cur.skip_form(specs[i++].form);
+		}
+	}
+	return cur.position();
+}
+
 sdb::attr sdb::die::operator[](std::uint64_t attribute) const {
 	auto& specs = abbrev_->attr_specs;
 	for (std::size_t i = 0; i < specs.size(); ++i) {
 		if (specs[i].attr == attribute) {
-			return { cu_, specs[i].attr, specs[i].form, attr_locs_[i] };
+			return { cu_, specs[i].attr, specs[i].form, attr_location(i) };
 		}
 	}
 
@@ -877,8 +1617,8 @@ sdb::attr sdb::die::operator[](std::uint64_t attribute) const {
 
 bool sdb::die::contains(std::uint64_t attribute) const {
 	auto& specs = abbrev_->attr_specs;
-	return std::find_if(begin(specs), end(specs),
-		[=](auto spec) { return spec.attr == attribute; }) != end(specs);
+	return std::find_if(specs.begin(), specs.end(),
+		[=](auto& spec) { return spec.attr == attribute; }) != specs.end();
 }
 
 sdb::file_addr sdb::attr::as_address() const {
@@ -950,13 +1690,11 @@ sdb::die sdb::attr::as_reference() const {
 		offset = cur.uleb128(); break;
 	case DW_FORM_ref_addr: {
 		offset = cur.u32();
-		auto section = cu_->dwarf_info()->elf_file()->get_section_contents(".debug_info");
-		auto die_pos = section.begin() + offset;
+		auto die_pos = cu_->dwarf_info()->debug_info().begin() + offset;
 		auto& cus = cu_->dwarf_info()->compile_units();
-		auto cu_finder = [=](auto& cu) {
-			return cu->data().begin() <= die_pos and cu->data().end() > die_pos;
-			};
-		auto cu_for_offset = std::find_if(begin(cus), end(cus), cu_finder);
+		// units are in section order, so find the last one starting at or before die_pos
+		auto cu_for_offset = std::prev(std::upper_bound(begin(cus), end(cus), die_pos,
+			[](auto pos, auto& cu) { return pos < cu->data().begin(); }));
 		cursor ref_cur({ die_pos, cu_for_offset->get()->data().end() });
 		return parse_die(**cu_for_offset, ref_cur);
 	}
@@ -975,7 +1713,7 @@ std::string_view sdb::attr::as_string() const {
 		return cur.string();
 	case DW_FORM_strp: {
 		auto offset = cur.u32();
-		auto stab = cu_->dwarf_info()->elf_file()->get_section_contents(".debug_str");
+		auto stab = cu_->dwarf_info()->debug_str();
 		cursor stab_cur({ stab.begin() + offset, stab.end() });
 		return stab_cur.string();
 	}
@@ -1030,8 +1768,7 @@ sdb::range_list::iterator::operator++(int) {
 }
 
 sdb::range_list sdb::attr::as_range_list() const {
-	auto section = cu_->dwarf_info()->elf_file()->get_section_contents(
-		".debug_ranges");
+	auto section = cu_->dwarf_info()->debug_ranges();
 	auto offset = as_section_offset();
 	span<const std::byte> data(section.begin() + offset, section.end());
 
@@ -1103,35 +1840,104 @@ sdb::file_addr sdb::die::high_pc() const {
 	error::send("DIE does not have high PC");
 }
 
+void sdb::dwarf::build_compile_unit_ranges() const {
+	open_index_cache();
+	std::call_once(compile_unit_ranges_once_, [this] {
+		for (auto& cu : compile_units()) {
+			for_each_range(cu->root(), [&](auto low, auto high) {
+				compile_unit_ranges_.insert(low, high, cu.get());
+				});
+		}
+		compile_unit_ranges_.finalize();
+		});
+}
+
 const sdb::compile_unit*
 sdb::dwarf::compile_unit_containing_address(file_addr address) const {
-	for (auto& cu : compile_units_) {
-		if (cu->root().contains_address(address)) {
-			return cu.get();
-		}
-	}
-	return nullptr;
+	if (address.elf_file() != elf_) return nullptr;
+
+	build_compile_unit_ranges();
+	auto found = compile_unit_ranges_.find(address.addr());
+	return found ? found->value : nullptr;
 }
 
 std::optional<sdb::die>
 sdb::dwarf::function_containing_address(file_addr address) const {
+	if (address.elf_file() != elf_) return std::nullopt;
+
 	index();
-	for (auto& [name, entry] : function_index_) {
-		cursor cur({ entry.pos, entry.cu->data().end() });
-		auto d = parse_die(*entry.cu, cur);
-		if (d.contains_address(address) and
-			d.abbrev_entry()->tag == DW_TAG_subprogram) {
-			return d;
+	auto found = function_ranges_.find(address.addr(), [](auto& e) {
+		return e.value.tag == DW_TAG_subprogram;
+		});
+	if (!found) return std::nullopt;
+
+	auto& entry = found->value.entry;
+	cursor cur({ entry.pos, entry.cu->data().end() });
+	return parse_die(*entry.cu, cur);
+}
+
+namespace {
+	template <class Index>
+	auto functions_named(const Index& index, std::string_view name) {
+		auto by_name = [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; };
+		typename Index::value_type key{ name, {} };
+		return std::equal_range(index.begin(), index.end(), key, by_name);
+	}
+}
+
+struct sdb::dwarf::function_index_shard {
+	std::vector<std::pair<std::string_view, index_entry>> functions;
+	std::vector<range_index<function_range_entry>::entry> ranges;
+	// functions with an abstract instance, so possibly inlined elsewhere
+	std::vector<std::string_view> inlined;
+};
+
+namespace {
+	// copies of a function inlined into other units aren't listed under
+	// its name in a name table. the unit holding the abstract instance
+	// may be, or only an out of line copy that doesn't say it's inlined
+	// elsewhere, which is likely for functions defined in headers
+	bool maybe_inlined_elsewhere(const sdb::die& function) {
+		if (function.abbrev_entry()->tag == DW_TAG_inlined_subroutine or
+			function.contains(DW_AT_abstract_origin)) {
+			return true;
 		}
+		auto unit_name = function.cu()->root().name();
+		return function.contains(DW_AT_decl_file) and unit_name and
+			function.file().path.filename() !=
+			std::filesystem::path(*unit_name).filename();
 	}
-	return std::nullopt;
 }
 
 std::vector<sdb::die> sdb::dwarf::find_functions(std::string name) const {
-	index();
-
 	std::vector<die> found;
-	auto [begin, end] = function_index_.equal_range(name);
+
+	// with a name table only the units it lists need to be walked. the
+	// table's keys may be qualified names though, so on a miss fall
+	// back to the full index, as for functions that may have been
+	// inlined into units the table doesn't list
+	if (has_name_index() and !indexed_) {
+		bool complete = true;
+		for (auto cu : compile_units_with_name(name)) {
+			auto& shard = unit_functions(*cu);
+			if (std::find(shard.inlined.begin(), shard.inlined.end(), name) !=
+				shard.inlined.end()) {
+				complete = false;
+			}
+			for (auto& [function_name, entry] : shard.functions) {
+				if (function_name == name) {
+					cursor cur({ entry.pos, entry.cu->data().end() });
+					found.push_back(parse_die(*entry.cu, cur));
+					if (maybe_inlined_elsewhere(found.back())) complete = false;
+				}
+			}
+		}
+		if (!found.empty() and complete) return found;
+		found.clear();
+	}
+
+	index();
+	auto [begin, end] = functions_named(function_index_, name);
 	std::transform(begin, end, std::back_inserter(found), [](auto& pair) {
 		auto [name, entry] = pair;
 		cursor cur({ entry.pos, entry.cu->data().end() });
@@ -1140,11 +1946,486 @@ std::vector<sdb::die> sdb::dwarf::find_functions(std::string name) const {
 	return found;
 }
 
+std::vector<const sdb::compile_unit*>
+sdb::dwarf::compile_units_with_name(std::string_view name) const {
+	std::vector<const compile_unit*> units;
+	if (has_name_index()) {
+		for (auto offset : name_index_->unit_offsets(name)) {
+			if (auto cu = compile_unit_at_offset(offset)) {
+				units.push_back(cu);
+			}
+		}
+	}
+	else {
+		index();
+		auto [begin, end] = functions_named(function_index_, name);
+		for (auto it = begin; it != end; ++it) {
+			units.push_back(it->second.cu);
+		}
+	}
+
+	auto by_position = [](auto lhs, auto rhs) {
+		return lhs->data().begin() < rhs->data().begin();
+	};
+	std::sort(units.begin(), units.end(), by_position);
+	units.erase(std::unique(units.begin(), units.end()), units.end());
+	return units;
+}
+
+const sdb::compile_unit*
+sdb::dwarf::compile_unit_at_offset(std::size_t offset) const {
+	auto& units = compile_units();
+	auto pos = debug_info().begin() + offset;
+	auto it = std::lower_bound(units.begin(), units.end(), pos,
+		[](auto& cu, auto pos) { return cu->data().begin() < pos; });
+	if (it == units.end() or (*it)->data().begin() != pos) return nullptr;
+	return it->get();
+}
+
+const sdb::dwarf::function_index_shard&
+sdb::dwarf::unit_functions(const compile_unit& cu) const {
+	std::lock_guard lock(unit_functions_mutex_);
+	auto& shard = unit_functions_[&cu];
+	if (!shard) {
+		shard = std::make_unique<function_index_shard>();
+		index_die(cu.root(), *shard);
+	}
+	return *shard;
+}
+
 void sdb::dwarf::index() const {
-	if (!function_index_.empty()) return;
-	for (auto& cu : compile_units_) {
-		index_die(cu->root());
+	open_index_cache();
+	std::call_once(index_once_, [this] { build_index(); });
+}
+
+void sdb::dwarf::index_in_background() const {
+	background_index_ = worker_pool::get().run([this] { index(); });
+}
+
+void sdb::dwarf::build_index() const {
+	auto& units = compile_units();
+	std::vector<function_index_shard> shards(units.size());
+	parallel_for(units.size(), [&](std::size_t i) {
+		index_die(units[i]->root(), shards[i]);
+		});
+
+	// merge in CU order so the result doesn't depend on scheduling
+	for (auto& shard : shards) {
+		function_index_.insert(function_index_.end(),
+			shard.functions.begin(), shard.functions.end());
+		for (auto& range : shard.ranges) {
+			function_ranges_.insert(range.low, range.high, range.value);
+		}
 	}
+	std::stable_sort(function_index_.begin(), function_index_.end(),
+		[](auto& lhs, auto& rhs) { return lhs.first < rhs.first; });
+	function_ranges_.finalize();
+	indexed_ = true;
+}
+
+namespace {
+	// the index cache file is a header followed by arrays of fixed size
+	// records, each at an 8 byte aligned offset
+	constexpr char index_cache_magic[8] = { 's', 'd', 'b', 'i', 'n', 'd', 'e', 'x' };
+	constexpr std::uint64_t index_cache_version = 1;
+
+	struct index_cache_array {
+		std::uint64_t offset;
+		std::uint64_t count;
+	};
+
+	struct index_cache_header {
+		char magic[8];
+		std::uint64_t version;
+		std::uint64_t file_size;
+		std::uint64_t modification_time;
+		std::uint64_t n_units;
+		index_cache_array key;
+		index_cache_array unit_ranges;
+		index_cache_array functions;
+		index_cache_array function_ranges;
+		index_cache_array line_tables;
+		index_cache_array row_addresses;
+		index_cache_array row_lines;
+		index_cache_array row_columns;
+		index_cache_array row_file_indices;
+		index_cache_array row_discriminators;
+		index_cache_array row_flags;
+	};
+
+	struct cached_range {
+		std::uint64_t low;
+		std::uint64_t high;
+		std::uint64_t unit;
+	};
+
+	// names are offsets into the ELF file, DIEs offsets into .debug_info
+	struct cached_function {
+		std::uint64_t name_offset;
+		std::uint64_t name_size;
+		std::uint64_t unit;
+		std::uint64_t die_offset;
+	};
+
+	struct cached_function_range {
+		std::uint64_t low;
+		std::uint64_t high;
+		std::uint64_t unit;
+		std::uint64_t die_offset;
+		std::uint64_t tag;
+	};
+
+	// units without a line table, or whose line program defines extra
+	// files, aren't cached and get decoded as usual
+	constexpr std::uint64_t uncached_line_table = ~std::uint64_t(0);
+	struct cached_line_table {
+		std::uint64_t first_row;
+		std::uint64_t n_rows;
+	};
+
+	// what a cache file has to match to be used for the file DWARF is
+	// read from, which may be a separate debug file. with a build ID the
+	// file may have been copied or touched since
+	struct index_cache_key {
+		std::vector<std::byte> id;
+		bool is_build_id;
+		std::uint64_t file_size;
+		std::uint64_t modification_time;
+		std::string file_name;
+	};
+
+	index_cache_key make_index_cache_key(const sdb::elf& elf) {
+		index_cache_key key;
+
+		struct stat stats;
+		if (stat(elf.path().c_str(), &stats) < 0) {
+			sdb::error::send_errno("Could not retrieve ELF file stats");
+		}
+		key.file_size = stats.st_size;
+		key.modification_time =
+			stats.st_mtim.tv_sec * 1'000'000'000ull + stats.st_mtim.tv_nsec;
+
+		auto to_hex = [](auto begin, auto end) {
+			std::string hex;
+			for (auto it = begin; it != end; ++it) {
+				auto byte = static_cast<std::uint8_t>(*it);
+				hex += "0123456789abcdef"[byte >> 4];
+				hex += "0123456789abcdef"[byte & 0xf];
+			}
+			return hex;
+		};
+
+		auto build_id = elf.build_id();
+		key.is_build_id = build_id.size() != 0;
+		if (key.is_build_id) {
+			key.id.assign(build_id.begin(), build_id.end());
+			key.file_name = to_hex(build_id.begin(), build_id.end());
+		}
+		else {
+			auto path = std::filesystem::absolute(elf.path()).string();
+			auto bytes = reinterpret_cast<const std::byte*>(path.data());
+			key.id.assign(bytes, bytes + path.size());
+			auto hash = std::hash<std::string>{}(path);
+			auto hash_bytes = sdb::as_bytes(hash);
+			key.file_name = to_hex(hash_bytes, hash_bytes + sizeof(hash));
+		}
+		key.file_name += ".sdbidx";
+		return key;
+	}
+
+	template <class T>
+	sdb::span<const T> cached_array(
+		sdb::span<const std::byte> file, index_cache_array array) {
+		if (array.offset % alignof(T) != 0 or array.offset > file.size() or
+			array.count > (file.size() - array.offset) / sizeof(T)) {
+			sdb::error::send("Corrupt index cache");
+		}
+		return { reinterpret_cast<const T*>(file.begin() + array.offset),
+			array.count };
+	}
+
+	class index_cache_writer {
+	public:
+		index_cache_writer() : data_(sizeof(index_cache_header)) {}
+
+		template <class T>
+		index_cache_array write(const std::vector<T>& values) {
+			data_.resize((data_.size() + 7) & ~std::size_t(7));
+			index_cache_array array{ data_.size(), values.size() };
+			auto bytes = reinterpret_cast<const std::byte*>(values.data());
+			data_.insert(data_.end(), bytes, bytes + values.size() * sizeof(T));
+			return array;
+		}
+
+		// writes to a temporary file first so that readers never see a
+		// partially written cache
+		void save(const std::filesystem::path& path,
+			const index_cache_header& header) {
+			std::copy(sdb::as_bytes(header),
+				sdb::as_bytes(header) + sizeof(header), data_.begin());
+
+			std::filesystem::create_directories(path.parent_path());
+			auto temporary = path;
+			temporary += "." + std::to_string(getpid()) + ".tmp";
+			{
+				std::ofstream out(temporary, std::ios::binary);
+				out.write(reinterpret_cast<const char*>(data_.data()), data_.size());
+				if (!out) {
+					std::filesystem::remove(temporary);
+					sdb::error::send("Could not write index cache");
+				}
+			}
+			std::filesystem::rename(temporary, path);
+		}
+
+	private:
+		std::vector<std::byte> data_;
+	};
+}
+
+void sdb::dwarf::use_index_cache(
+	const std::filesystem::path& directory, bool in_background) const {
+	index_cache_directory_ = directory;
+	if (in_background) {
+		background_index_ = worker_pool::get().run([this] { open_index_cache(); });
+	}
+}
+
+void sdb::dwarf::open_index_cache() const {
+	if (index_cache_directory_.empty()) return;
+
+	// a broken or unwritable cache only costs the time to rebuild it.
+	// that happens outside call_once since building the index opens
+	// the cache too
+	std::filesystem::path path;
+	std::call_once(index_cache_once_, [&] {
+		try {
+			auto candidate = index_cache_directory_ /
+				make_index_cache_key(*debug_file()).file_name;
+			if (!load_index_cache(candidate)) path = candidate;
+		}
+		catch (std::exception&) {}
+		});
+	if (path.empty()) return;
+
+	try {
+		write_index_cache(path);
+	}
+	catch (std::exception&) {}
+}
+
+bool sdb::dwarf::load_index_cache(const std::filesystem::path& path) const {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat stats;
+	void* mapping = MAP_FAILED;
+	if (fstat(fd, &stats) == 0 and
+		std::size_t(stats.st_size) >= sizeof(index_cache_header)) {
+		mapping = mmap(nullptr, stats.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (mapping == MAP_FAILED) return false;
+
+	span<const std::byte> file{
+		reinterpret_cast<const std::byte*>(mapping), std::size_t(stats.st_size) };
+	auto unmap = [&] { munmap(mapping, file.size()); };
+
+	auto& units = compile_units();
+	auto key = make_index_cache_key(*debug_file());
+	auto header = from_bytes<index_cache_header>(file.begin());
+	std::vector<std::pair<std::string_view, index_entry>> functions;
+	range_index<function_range_entry> function_ranges;
+	range_index<const compile_unit*> unit_ranges;
+	try {
+		auto cached_key = cached_array<std::byte>(file, header.key);
+		if (std::memcmp(header.magic, index_cache_magic, sizeof(index_cache_magic)) != 0 or
+			header.version != index_cache_version or
+			header.n_units != units.size() or
+			!std::equal(cached_key.begin(), cached_key.end(),
+				key.id.begin(), key.id.end()) or
+			(!key.is_build_id and (header.file_size != key.file_size or
+				header.modification_time != key.modification_time))) {
+			unmap();
+			return false;
+		}
+
+		auto elf_data = debug_file_->file_offset_as_data_pointer(file_offset(*debug_file_, 0));
+		auto entry_at = [&](std::uint64_t unit, std::uint64_t die_offset) {
+			if (unit >= units.size() or die_offset >= debug_info_.size()) {
+				error::send("Corrupt index cache");
+			}
+			return index_entry{ units[unit].get(), debug_info_.begin() + die_offset };
+		};
+
+		for (auto& function : cached_array<cached_function>(file, header.functions)) {
+			if (function.name_offset > debug_file_->file_size() or
+				function.name_size > debug_file_->file_size() - function.name_offset) {
+				error::send("Corrupt index cache");
+			}
+			std::string_view name(
+				reinterpret_cast<const char*>(elf_data + function.name_offset),
+				function.name_size);
+			functions.emplace_back(name, entry_at(function.unit, function.die_offset));
+		}
+		for (auto& range : cached_array<cached_function_range>(
+			file, header.function_ranges)) {
+			function_ranges.insert(range.low, range.high,
+				{ entry_at(range.unit, range.die_offset), range.tag });
+		}
+		for (auto& range : cached_array<cached_range>(file, header.unit_ranges)) {
+			if (range.unit >= units.size()) error::send("Corrupt index cache");
+			unit_ranges.insert(range.low, range.high, units[range.unit].get());
+		}
+
+		auto n_rows = header.row_addresses.count;
+		for (auto array : { header.row_lines, header.row_columns,
+			header.row_file_indices, header.row_discriminators, header.row_flags }) {
+			if (array.count != n_rows) error::send("Corrupt index cache");
+		}
+		cached_array<std::uint64_t>(file, header.row_addresses);
+		cached_array<std::uint32_t>(file, header.row_lines);
+		cached_array<std::uint32_t>(file, header.row_columns);
+		cached_array<std::uint32_t>(file, header.row_file_indices);
+		cached_array<std::uint32_t>(file, header.row_discriminators);
+		cached_array<std::uint8_t>(file, header.row_flags);
+		auto tables = cached_array<cached_line_table>(file, header.line_tables);
+		if (tables.size() != units.size()) error::send("Corrupt index cache");
+		for (auto& table : tables) {
+			if (table.n_rows != uncached_line_table and
+				(table.first_row > n_rows or table.n_rows > n_rows - table.first_row)) {
+				error::send("Corrupt index cache");
+			}
+		}
+	}
+	catch (std::exception&) {
+		unmap();
+		return false;
+	}
+
+	std::call_once(index_once_, [&] {
+		function_index_ = std::move(functions);
+		function_ranges_ = std::move(function_ranges);
+		function_ranges_.finalize();
+		indexed_ = true;
+		});
+	std::call_once(compile_unit_ranges_once_, [&] {
+		unit_ranges.finalize();
+		compile_unit_ranges_ = std::move(unit_ranges);
+		});
+	index_cache_ = file;
+	index_cache_loaded_ = true;
+	return true;
+}
+
+bool sdb::dwarf::load_cached_line_rows(const line_table& table) const {
+	open_index_cache();
+	if (index_cache_.size() == 0) return false;
+
+	auto& units = compile_units();
+	auto it = std::lower_bound(units.begin(), units.end(), table.cu_,
+		[](auto& cu, auto target) {
+			return cu->data().begin() < target->data().begin();
+		});
+	if (it == units.end() or it->get() != table.cu_) return false;
+
+	auto header = from_bytes<index_cache_header>(index_cache_.begin());
+	auto cached = cached_array<cached_line_table>(
+		index_cache_, header.line_tables)[it - units.begin()];
+	if (cached.n_rows == uncached_line_table) return false;
+
+	// the rows stay in the mapping, which lives as long as this does
+	auto use_rows = [&](auto& column, auto array) {
+		using value_type = std::remove_const_t<
+			std::remove_reference_t<decltype(column[0])>>;
+		auto values = cached_array<value_type>(index_cache_, array);
+		column = { values.begin() + cached.first_row, std::size_t(cached.n_rows) };
+	};
+	use_rows(table.rows_.addresses, header.row_addresses);
+	use_rows(table.rows_.lines, header.row_lines);
+	use_rows(table.rows_.columns, header.row_columns);
+	use_rows(table.rows_.file_indices, header.row_file_indices);
+	use_rows(table.rows_.discriminators, header.row_discriminators);
+	use_rows(table.rows_.flags, header.row_flags);
+	return true;
+}
+
+void sdb::dwarf::write_index_cache(const std::filesystem::path& path) const {
+	index();
+	auto& units = compile_units();
+	auto key = make_index_cache_key(*debug_file());
+
+	std::unordered_map<const compile_unit*, std::uint64_t> unit_numbers;
+	for (std::size_t i = 0; i < units.size(); ++i) {
+		unit_numbers[units[i].get()] = i;
+	}
+
+	std::vector<cached_function> functions;
+	for (auto& [name, entry] : function_index_) {
+		auto name_offset = debug_file_->data_pointer_as_file_offset(
+			reinterpret_cast<const std::byte*>(name.data())).off();
+		functions.push_back({ name_offset, name.size(),
+			unit_numbers[entry.cu], std::uint64_t(entry.pos - debug_info_.begin()) });
+	}
+
+	std::vector<cached_function_range> function_ranges;
+	for (auto& range : function_ranges_.entries()) {
+		auto& entry = range.value.entry;
+		function_ranges.push_back({ range.low, range.high, unit_numbers[entry.cu],
+			std::uint64_t(entry.pos - debug_info_.begin()), range.value.tag });
+	}
+
+	// everything else is built here rather than through the shared
+	// caches so that this can run alongside lookups
+	std::vector<cached_range> unit_ranges;
+	std::vector<cached_line_table> tables;
+	line_table::rows rows;
+	for (std::size_t i = 0; i < units.size(); ++i) {
+		for_each_range(units[i]->root(), [&](auto low, auto high) {
+			unit_ranges.push_back({ low, high, i });
+			});
+
+		auto table = parse_line_table(*units[i]);
+		auto n_files = table ? table->file_names_.size() : 0;
+		if (table) table->run_program();
+		if (!table or table->file_names_.size() != n_files) {
+			tables.push_back({ 0, uncached_line_table });
+			continue;
+		}
+
+		auto& table_rows = table->rows_;
+		tables.push_back({ rows.addresses.size(), table_rows.addresses.size() });
+		auto append = [](auto& to, auto& from) {
+			to.insert(to.end(), from.begin(), from.end());
+		};
+		append(rows.addresses, table_rows.addresses);
+		append(rows.lines, table_rows.lines);
+		append(rows.columns, table_rows.columns);
+		append(rows.file_indices, table_rows.file_indices);
+		append(rows.discriminators, table_rows.discriminators);
+		append(rows.flags, table_rows.flags);
+	}
+
+	index_cache_writer writer;
+	index_cache_header header{};
+	std::copy(std::begin(index_cache_magic), std::end(index_cache_magic),
+		header.magic);
+	header.version = index_cache_version;
+	header.file_size = key.file_size;
+	header.modification_time = key.modification_time;
+	header.n_units = units.size();
+	header.key = writer.write(key.id);
+	header.unit_ranges = writer.write(unit_ranges);
+	header.functions = writer.write(functions);
+	header.function_ranges = writer.write(function_ranges);
+	header.line_tables = writer.write(tables);
+	header.row_addresses = writer.write(rows.addresses);
+	header.row_lines = writer.write(rows.lines);
+	header.row_columns = writer.write(rows.columns);
+	header.row_file_indices = writer.write(rows.file_indices);
+	header.row_discriminators = writer.write(rows.discriminators);
+	header.row_flags = writer.write(rows.flags);
+	writer.save(path, header);
 }
 
 std::optional<std::string_view> sdb::die::name() const {
@@ -1160,40 +2441,48 @@ std::optional<std::string_view> sdb::die::name() const {
 	return std::nullopt;
 }
 
-void sdb::dwarf::index_die(const die& current) const {
+void sdb::dwarf::index_die(
+	const die& current, function_index_shard& shard) const {
 	bool has_range = current.contains(DW_AT_low_pc) or current.contains(DW_AT_ranges);
 	bool is_function = current.abbrev_entry()->tag == DW_TAG_subprogram or
 		current.abbrev_entry()->tag == DW_TAG_inlined_subroutine;
+	if (current.abbrev_entry()->tag == DW_TAG_subprogram and current.contains(DW_AT_inline)) {
+		if (auto name = current.name(); name) shard.inlined.push_back(*name);
+	}
 	if (has_range and is_function) {
 		if (auto name = current.name(); name) {
 			index_entry entry{ current.cu(), current.position() };
-			function_index_.emplace(*name, entry);
+			shard.functions.emplace_back(*name, entry);
+			for_each_range(current, [&](auto low, auto high) {
+				shard.ranges.push_back(
+					{ low, high, { entry, current.abbrev_entry()->tag } });
+				});
 		}
 	}
 	for (auto child : current.children()) {
-		index_die(child);
+		index_die(child, shard);
 	}
 }
 
 sdb::compile_unit::compile_unit(
-	dwarf& parent,
+	const dwarf& parent,
 	span<const std::byte> data,
 	std::size_t abbrev_offset)
 	: parent_(&parent)
 	, data_(data)
 	, abbrev_offset_(abbrev_offset) {
-	line_table_ = parse_line_table(*this);
 }
 
-sdb::line_table::iterator::iterator(const sdb::line_table* table)
-	: table_(table), pos_(table->data_.begin()) {
-	registers_.is_stmt = table->default_is_stmt_;
-	++(*this);
+sdb::line_table::iterator::iterator(
+	const sdb::line_table* table, std::size_t index)
+	: table_(table), index_(index), current_(table->row(index)) {
 }
 
 sdb::line_table::iterator
 sdb::line_table::begin() const {
-	return iterator(this);
+	decode();
+	if (rows_.addresses.size() == 0) return end();
+	return iterator(this, 0);
 }
 sdb::line_table::iterator
 sdb::line_table::end() const {
@@ -1202,17 +2491,11 @@ sdb::line_table::end() const {
 
 sdb::line_table::iterator&
 sdb::line_table::iterator::operator++() {
-	if (pos_ == table_->data_.end()) {
-		pos_ = nullptr;
+	if (++index_ == table_->rows_.addresses.size()) {
+		*this = iterator{};
 		return *this;
 	}
-
-	bool emitted = false;
-	do {
-		emitted = execute_instruction();
-	} while (!emitted);
-
-	current_.file_entry = &table_->file_names_[current_.file_index - 1];
+	current_ = table_->row(index_);
 	return *this;
 }
 
@@ -1223,52 +2506,119 @@ sdb::line_table::iterator::operator++(int) {
 	return tmp;
 }
 
-bool sdb::line_table::iterator::execute_instruction() {
-	auto elf = table_->cu_->dwarf_info()->elf_file();
-	cursor cur({ pos_, table_->data_.end() });
+void sdb::line_table::decode() const {
+	// DW_LNE_define_file adds to file_names_ while this runs, so it
+	// happens exactly once even with concurrent readers
+	std::call_once(decode_once_, [this] {
+		if (!cu_->dwarf_info()->load_cached_line_rows(*this)) {
+			run_program();
+		}
+
+		std::size_t sequence_start = 0;
+		for (std::size_t i = 0; i < rows_.flags.size(); ++i) {
+			if (rows_.flags[i] & end_sequence_flag) {
+				sequences_.insert(rows_.addresses[sequence_start],
+					rows_.addresses[i], { sequence_start, i });
+				sequence_start = i + 1;
+			}
+		}
+		sequences_.finalize();
+		});
+}
+
+void sdb::line_table::run_program() const {
+	entry registers;
+	registers.is_stmt = default_is_stmt_;
+
+	auto pos = data_.begin();
+	while (pos != data_.end()) {
+		entry emitted;
+		if (!execute_instruction(pos, registers, emitted)) continue;
+
+		decoded_rows_.addresses.push_back(emitted.address.addr());
+		decoded_rows_.lines.push_back(static_cast<std::uint32_t>(emitted.line));
+		decoded_rows_.columns.push_back(static_cast<std::uint32_t>(emitted.column));
+		decoded_rows_.file_indices.push_back(static_cast<std::uint32_t>(emitted.file_index));
+		decoded_rows_.discriminators.push_back(static_cast<std::uint32_t>(emitted.discriminator));
+		decoded_rows_.flags.push_back(
+			(emitted.is_stmt ? is_stmt_flag : 0) |
+			(emitted.basic_block_start ? basic_block_start_flag : 0) |
+			(emitted.end_sequence ? end_sequence_flag : 0) |
+			(emitted.prologue_end ? prologue_end_flag : 0) |
+			(emitted.epilogue_begin ? epilogue_begin_flag : 0));
+	}
+
+	rows_ = { decoded_rows_.addresses, decoded_rows_.lines, decoded_rows_.columns,
+		decoded_rows_.file_indices, decoded_rows_.discriminators, decoded_rows_.flags };
+}
+
+sdb::line_table::entry
+sdb::line_table::row(std::size_t index) const {
+	auto elf = cu_->dwarf_info()->elf_file();
+	auto flags = rows_.flags[index];
+
+	entry e;
+	e.address = file_addr(*elf, rows_.addresses[index]);
+	e.file_index = rows_.file_indices[index];
+	e.line = rows_.lines[index];
+	e.column = rows_.columns[index];
+	e.is_stmt = flags & is_stmt_flag;
+	e.basic_block_start = flags & basic_block_start_flag;
+	e.end_sequence = flags & end_sequence_flag;
+	e.prologue_end = flags & prologue_end_flag;
+	e.epilogue_begin = flags & epilogue_begin_flag;
+	e.discriminator = rows_.discriminators[index];
+	e.file_entry = &file_names_[e.file_index - 1];
+	return e;
+}
+
+bool sdb::line_table::execute_instruction(const std::byte*& pos,
+	entry& registers, entry& current) const {
+	auto elf = cu_->dwarf_info()->elf_file();
+	cursor cur({ pos, data_.end() });
 	auto opcode = cur.u8();
 	bool emitted = false;
 
-	if (opcode > 0 and opcode < table_->opcode_base_) {
+	if (opcode > 0 and opcode < opcode_base_) {
 		switch (opcode) {
 		case DW_LNS_copy:
-			current_ = registers_;
-			registers_.basic_block_start = false;
-			registers_.prologue_end = false;
-			registers_.epilogue_begin = false;
-			registers_.discriminator = 0;
+			current = registers;
+			registers.basic_block_start = false;
+			registers.prologue_end = false;
+			registers.epilogue_begin = false;
+			registers.discriminator = 0;
 			emitted = true;
 			break;
 		case DW_LNS_advance_pc:
-			registers_.address += cur.uleb128();
+			registers.address += cur.uleb128();
 			break;
 		case DW_LNS_advance_line:
-			registers_.line += cur.sleb128();
+			registers.line += cur.sleb128();
 			break;
 		case DW_LNS_set_file:
-			registers_.file_index = cur.uleb128();
+			registers.file_index = cur.uleb128();
 			break;
 		case DW_LNS_set_column:
-			registers_.column = cur.uleb128();
+			registers.column = cur.uleb128();
 			break;
 		case DW_LNS_negate_stmt:
-			registers_.is_stmt = !registers_.is_stmt;
+			registers.is_stmt = !registers.is_stmt;
 			break;
 		case DW_LNS_set_basic_block:
-			registers_.basic_block_start = true;
+			registers.basic_block_start = true;
 			break;
 		case DW_LNS_const_add_pc:
-			registers_.address +=
-				(255 - table_->opcode_base_) / table_->line_range_;
+			registers.address +=
+				(255 - opcode_base_) / line_range_;
 			break;
 		case DW_LNS_fixed_advance_pc:
-			registers_.address += cur.u16();
+			registers.address += cur.u16();
 			break;
 		case DW_LNS_set_prologue_end:
-			registers_.prologue_end = true;
+			registers.prologue_end = true;
 			break;
 		case DW_LNS_set_epilogue_begin:
-			registers_.epilogue_begin = true;
+			registers.epilogue_begin = true;
 			break;
 		case DW_LNS_set_isa:
 			break;
@@ -1282,62 +2632,59 @@ bool sdb::line_table::iterator::execute_instruction() {
 
 		switch (extended_opcode) {
 		case DW_LNE_end_sequence:
-			registers_.end_sequence = true;
-			current_ = registers_;
-			registers_ = entry{};
-			registers_.is_stmt = table_->default_is_stmt_;
+			registers.end_sequence = true;
+			current = registers;
+			registers = entry{};
+			registers.is_stmt = default_is_stmt_;
 			emitted = true;
 			break;
 		case DW_LNE_set_address:
-			registers_.address = file_addr(
+			registers.address = file_addr(
 				*elf, cur.u64());
 			break;
 		case DW_LNE_define_file: {
 			auto compilation_dir =
-				table_->cu_->root()[DW_AT_comp_dir].as_string();
+				cu_->root()[DW_AT_comp_dir].as_string();
 			auto file = parse_line_table_file(
-				cur, std::string(compilation_dir), table_->include_directories_);
-			table_->file_names_.push_back(file);
+				cur, std::string(compilation_dir), include_directories_);
+			file_names_.push_back(file);
 			break;
 		}
 		case DW_LNE_set_discriminator:
-			registers_.discriminator = cur.uleb128();
+			registers.discriminator = cur.uleb128();
 			break;
 		default:
 			error::send("Unexpected extended opcode");
 		}
 	}
 	else {
-		auto adjusted_opcode = opcode - table_->opcode_base_;
-		registers_.address += adjusted_opcode / table_->line_range_;
-		registers_.line +=
-			table_->line_base_ + (adjusted_opcode % table_->line_range_);
-		current_ = registers_;
-		registers_.basic_block_start = false;
-		registers_.prologue_end = false;
-		registers_.epilogue_begin = false;
-		registers_.discriminator = 0;
+		auto adjusted_opcode = opcode - opcode_base_;
+		registers.address += adjusted_opcode / line_range_;
+		registers.line +=
+			line_base_ + (adjusted_opcode % line_range_);
+		current = registers;
+		registers.basic_block_start = false;
+		registers.prologue_end = false;
+		registers.epilogue_begin = false;
+		registers.discriminator = 0;
 		emitted = true;
 	}
 
-	pos_ = cur.position();
+	pos = cur.position();
 	return emitted;
 }
 
 sdb::line_table::iterator
 sdb::line_table::get_entry_by_address(file_addr address) const {
-	auto prev = begin();
-	if (prev == end()) return prev;
-
-	auto it = prev;
-	for (++it; it != end(); prev = it++) {
-		if (prev->address <= address and
-			it->address > address and
-			!prev->end_sequence) {
-			return prev;
-		}
-	}
-	return end();
+	decode();
+	auto sequence = sequences_.find(address.addr());
+	if (!sequence) return end();
+
+	// last row of the sequence at or before the address
+	auto first = rows_.addresses.begin() + sequence->value.first_row;
+	auto last = rows_.addresses.begin() + sequence->value.end_row;
+	last = std::upper_bound(first, last, address.addr());
+	return iterator(this, (last - rows_.addresses.begin()) - 1);
 }
 
 namespace {
@@ -1353,21 +2700,80 @@ namespace {
 std::vector<sdb::line_table::iterator>
 sdb::line_table::get_entries_by_line(
 	std::filesystem::path path, std::size_t line) const {
+	decode();
 	std::vector<iterator> entries;
 
-	for (auto it = begin(); it != end(); ++it) {
-		auto& entry_path = it->file_entry->path;
-		if (it->line == line) {
-			if ((path.is_absolute() and entry_path == path) or
-				(path.is_relative() and path_ends_in(entry_path, path))) {
-				entries.push_back(it);
-			}
+	for (std::size_t i = 0; i < rows_.lines.size(); ++i) {
+		if (rows_.lines[i] != line) continue;
+		auto& entry_path = file_names_[rows_.file_indices[i] - 1].path;
+		if ((path.is_absolute() and entry_path == path) or
+			(path.is_relative() and path_ends_in(entry_path, path))) {
+			entries.emplace_back(this, i);
 		}
 	}
 
 	return entries;
 }
 
+void sdb::dwarf::build_line_index() const {
+	std::call_once(line_index_once_, [this] {
+		std::unordered_map<std::string, std::size_t> file_ids;
+		for (auto& cu : compile_units()) {
+			auto& table = cu->lines();
+
+			// intern each file of this table once instead of once per row
+			std::vector<std::size_t> table_file_ids;
+			for (auto& file : table.file_names()) {
+				auto [it, inserted] = file_ids.try_emplace(
+					file.path.string(), line_index_files_.size());
+				if (inserted) {
+					line_index_files_.push_back({ file.path, {} });
+					line_index_by_filename_[file.path.filename().string()]
+						.push_back(it->second);
+				}
+				table_file_ids.push_back(it->second);
+			}
+
+			std::size_t row = 0;
+			for (auto it = table.begin(); it != table.end(); ++it, ++row) {
+				auto& file = line_index_files_[table_file_ids[it->file_index - 1]];
+				file.rows.push_back({ it->line, &table, row });
+			}
+		}
+
+		for (auto& file : line_index_files_) {
+			std::stable_sort(file.rows.begin(), file.rows.end(),
+				[](auto& lhs, auto& rhs) { return lhs.line < rhs.line; });
+		}
+		});
+}
+
+std::vector<sdb::line_table::iterator>
+sdb::dwarf::line_entries_by_line(
+	const std::filesystem::path& path, std::size_t line) const {
+	build_line_index();
+	std::vector<line_table::iterator> entries;
+
+	auto candidates = line_index_by_filename_.find(path.filename().string());
+	if (candidates == line_index_by_filename_.end()) return entries;
+
+	for (auto id : candidates->second) {
+		auto& file = line_index_files_[id];
+		if ((path.is_absolute() and file.path != path) or
+			(path.is_relative() and !path_ends_in(file.path, path))) {
+			continue;
+		}
+
+		auto [begin, end] = std::equal_range(
+			file.rows.begin(), file.rows.end(), line_index_row{ line, nullptr, 0 },
+			[](auto& lhs, auto& rhs) { return lhs.line < rhs.line; });
+		for (auto it = begin; it != end; ++it) {
+			entries.emplace_back(it->table, it->row);
+		}
+	}
+	return entries;
+}
+
 
 sdb::source_location
 sdb::die::location() const {
@@ -1394,27 +2800,27 @@ std::uint64_t sdb::die::line() const {
 }
 
 std::vector<sdb::die> sdb::dwarf::inline_stack_at_address(file_addr address) const {
-    auto func = function_containing_address(address);
-    std::vector<sdb::die> stack;
-
-    if (func) {
-        stack.push_back(*func);
-        while (true) {
-            const auto& children = stack.back().children();
-            auto found = std::find_if(children.begin(), children.end(),
-                [=](auto& child) {
-                return child.abbrev_entry()->tag == DW_TAG_inlined_subroutine and
-                child.contains_address(address);
-            });  
-
-            if (found == children.end()) {
-                break;
-            }
-            else {
-                stack.push_back(*found);
-            }
-        }
-    }
+	std::vector<sdb::die> stack;
+	if (address.elf_file() != elf_) return stack;
+
+	auto cu = compile_unit_containing_address(address);
+	if (!cu) {
+		// units without ranges of their own aren't in the unit index
+		auto func = function_containing_address(address);
+		if (!func) return stack;
+		cu = func->cu();
+	}
 
-    return stack;
-}
\ No newline at end of file
+	for (auto scope : cu->scopes().scopes_containing(address.addr())) {
+		// the innermost subprogram and what's inlined into it
+		if (scope->tag == DW_TAG_subprogram) {
+			stack.clear();
+		}
+		else if (scope->tag != DW_TAG_inlined_subroutine or stack.empty()) {
+			continue;
+		}
+		cursor cur({ scope->position, cu->data().end() });
+		stack.push_back(parse_die(*cu, cur));
+	}
+	return stack;
+}
@@ -7,11 +7,16 @@
 #include <libsdb/error.hpp>
 #include <libsdb/bit.hpp>
 #include <cxxabi.h>
+#include <cstring>
 #include <algorithm>
+#include <tuple>
+#include <array>
 #include <libsdb/dwarf.hpp>
+#include <parallel.hpp>
 
-sdb::elf::elf(const std::filesystem::path& path) {
+sdb::elf::elf(const std::filesystem::path& path, elf_options options) {
     path_ = path;
+    debug_directories_ = std::move(options.debug_directories);
 
     if ((fd_ = open(path_.c_str(), O_LARGEFILE, O_RDONLY)) < 0 ) {
         error::send_errno("Could not open ELF file");
@@ -36,11 +41,19 @@ sdb::elf::elf(const std::filesystem::path& path) {
     parse_section_headers();
     build_section_map();
     parse_symbol_table();
-    build_symbol_maps();
     dwarf_ = std::make_unique<dwarf>(*this);
+    if (!options.index_cache_directory.empty()) {
+        dwarf_->use_index_cache(
+            options.index_cache_directory, options.index_in_background);
+    }
+    else if (options.index_in_background) {
+        dwarf_->index_in_background();
+    }
 }
 
 sdb::elf::~elf() {
+    // the DWARF data may still be read by a background indexer
+    dwarf_.reset();
     munmap(data_, file_size_);
     close(fd_);
 }
@@ -68,7 +81,15 @@ std::string_view sdb::elf::get_section_name(std::size_t index) const {
 void sdb::elf::build_section_map() {
     for (auto& section : section_headers_) {
         section_map_[get_section_name(section.sh_name)] = &section;
+
+        // .tbss only exists per thread and overlaps whatever follows it
+        bool is_tbss = (section.sh_flags & SHF_TLS) and section.sh_type == SHT_NOBITS;
+        if ((section.sh_flags & SHF_ALLOC) and section.sh_size != 0 and !is_tbss) {
+            loaded_sections_.push_back(&section);
+        }
     }
+    std::sort(loaded_sections_.begin(), loaded_sections_.end(),
+        [](auto lhs, auto rhs) { return lhs->sh_addr < rhs->sh_addr; });
 }
 
 std::optional<const Elf64_Shdr*> sdb::elf::get_section(std::string_view name) const {
@@ -86,6 +107,131 @@ sdb::span<const std::byte> sdb::elf::get_section_contents(std::string_view name)
     return { nullptr, std::size_t(0) };
 }
 
+sdb::span<const std::byte> sdb::elf::build_id() const {
+    auto align = [](std::size_t size) { return (size + 3) & ~std::size_t(3); };
+
+    for (auto& section : section_headers_) {
+        if (section.sh_type != SHT_NOTE) continue;
+
+        auto pos = data_ + section.sh_offset;
+        auto end = pos + section.sh_size;
+        while (pos + sizeof(Elf64_Nhdr) <= end) {
+            auto note = from_bytes<Elf64_Nhdr>(pos);
+            auto name = pos + sizeof(Elf64_Nhdr);
+            auto desc = name + align(note.n_namesz);
+            auto next = desc + align(note.n_descsz);
+            if (next > end) break;
+
+            if (note.n_type == NT_GNU_BUILD_ID and note.n_namesz == 4 and
+                std::memcmp(name, "GNU", 4) == 0) {
+                return { desc, note.n_descsz };
+            }
+            pos = next;
+        }
+    }
+    return { nullptr, std::size_t(0) };
+}
+
+namespace {
+    // the CRC-32 that .gnu_debuglink records, as in zlib
+    std::uint32_t crc32(sdb::span<const std::byte> data) {
+        static const auto table = [] {
+            std::array<std::uint32_t, 256> table;
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                auto crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+                }
+                table[i] = crc;
+            }
+            return table;
+        }();
+
+        std::uint32_t crc = 0xffffffff;
+        for (auto byte : data) {
+            crc = table[(crc ^ static_cast<std::uint8_t>(byte)) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    std::string to_hex(sdb::span<const std::byte> data) {
+        std::string hex;
+        for (auto byte : data) {
+            hex += "0123456789abcdef"[static_cast<std::uint8_t>(byte) >> 4];
+            hex += "0123456789abcdef"[static_cast<std::uint8_t>(byte) & 0xf];
+        }
+        return hex;
+    }
+}
+
+const sdb::elf& sdb::elf::debug_file() const {
+    std::call_once(debug_file_once_, [this] {
+        if (!get_section(".debug_info")) debug_file_ = find_debug_file();
+    });
+    return debug_file_ ? *debug_file_ : *this;
+}
+
+std::unique_ptr<sdb::elf> sdb::elf::find_debug_file() const {
+    auto open_debug_file = [](const std::filesystem::path& path) -> std::unique_ptr<elf> {
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) return nullptr;
+        try {
+            auto debug = std::make_unique<elf>(path);
+            if (!debug->get_section(".debug_info")) return nullptr;
+
+            // distro debug files are often compressed or DWARF 5. those are
+            // passed over like a missing file, rather than failing every
+            // lookup in the object
+            for (auto& section : debug->section_headers_) {
+                auto name = debug->get_section_name(section.sh_name);
+                if (name.substr(0, 6) == ".debug" and (section.sh_flags & SHF_COMPRESSED)) {
+                    return nullptr;
+                }
+            }
+            debug->get_dwarf().compile_units();
+            return debug;
+        }
+        catch (std::exception&) {}
+        return nullptr;
+    };
+
+    // <dir>/.build-id/ab/cdef....debug for build ID abcdef...
+    if (auto id = build_id(); id.size() > 1) {
+        auto hex = to_hex(id);
+        for (auto& directory : debug_directories_) {
+            auto path = directory / ".build-id" / hex.substr(0, 2) / (hex.substr(2) + ".debug");
+            auto debug = open_debug_file(path);
+            if (debug and to_hex(debug->build_id()) == hex) return debug;
+        }
+    }
+
+    // .gnu_debuglink is a file name, padding to four bytes and the
+    // CRC-32 of the debug file, which is looked for next to the binary,
+    // in .debug/ next to it, and under each debug directory
+    auto link = get_section_contents(".gnu_debuglink");
+    auto name_size = link.size() ?
+        strnlen(reinterpret_cast<const char*>(link.begin()), link.size()) : 0;
+    auto crc_offset = (name_size + 4) & ~std::size_t(3);
+    if (name_size == 0 or crc_offset + sizeof(std::uint32_t) > link.size()) return nullptr;
+
+    std::string name(reinterpret_cast<const char*>(link.begin()), name_size);
+    auto crc = from_bytes<std::uint32_t>(link.begin() + crc_offset);
+
+    std::error_code ec;
+    auto directory = std::filesystem::absolute(path_, ec).parent_path();
+    std::vector<std::filesystem::path> candidates{
+        directory / name, directory / ".debug" / name };
+    for (auto& debug_directory : debug_directories_) {
+        candidates.push_back(debug_directory / directory.relative_path() / name);
+    }
+
+    for (auto& candidate : candidates) {
+        auto debug = open_debug_file(candidate);
+        if (debug and crc32({ debug->data_, debug->file_size_ }) == crc) return debug;
+    }
+    return nullptr;
+}
+
 std::string_view sdb::elf::get_string(std::size_t index) const {
     auto opt_strtab = get_section(".strtab");
     if (!opt_strtab) {
@@ -102,22 +248,23 @@ const Elf64_Shdr* sdb::elf::get_section_containing_address(file_addr addr) const
     if (addr.elf_file() != this)
         return nullptr;
 
-    for (auto& section : section_headers_) {
-        if (section.sh_addr <= addr.addr() and section.sh_addr + section.sh_size > addr.addr())
-            return &section;
-    }
+    auto it = std::upper_bound(loaded_sections_.begin(), loaded_sections_.end(),
+        addr.addr(), [](auto address, auto section) { return address < section->sh_addr; });
+    if (it == loaded_sections_.begin()) return nullptr;
+
+    auto section = *std::prev(it);
+    if (addr.addr() < section->sh_addr + section->sh_size)
+        return section;
 
     return nullptr;
 }
 
 const Elf64_Shdr* sdb::elf::get_section_containing_address(virt_addr addr) const {
-    for (auto& section : section_headers_) {
-        if (load_bias_+ section.sh_addr <= addr and 
-            load_bias_ + section.sh_addr + section.sh_size > addr)
-            return &section;
-    }
+    if (addr.addr() < load_bias_.addr())
+        return nullptr;
 
-    return nullptr;
+    return get_section_containing_address(
+        file_addr{ *this, addr.addr() - load_bias_.addr() });
 }
 
 std::optional<sdb::file_addr> sdb::elf::get_section_start_addr(std::string_view name) const {
@@ -133,67 +280,323 @@ void sdb::elf::parse_symbol_table() {
     if (!opt_symtab) {
         opt_symtab = get_section(".dynsym");
         if (!opt_symtab) return;
+        find_symbol_hash_tables(**opt_symtab);
     }   
 
     auto symtab = *opt_symtab;
-    symbol_table_.resize(symtab->sh_size / symtab->sh_entsize);
-    std::copy(data_ + symtab->sh_offset, 
-        data_ + symtab->sh_offset + symtab->sh_size, 
-        reinterpret_cast<std::byte*>(symbol_table_.data())
-    );
+    symbol_table_ = {
+        reinterpret_cast<const Elf64_Sym*>(data_ + symtab->sh_offset),
+        symtab->sh_size / symtab->sh_entsize
+    };
 }
 
-void sdb::elf::build_symbol_maps() {
-    for (auto& symbol : symbol_table_) {
-        auto mangled_name = get_string(symbol.st_name);
-        int demangle_status;
+void sdb::elf::find_symbol_hash_tables(const Elf64_Shdr& dynsym) {
+    auto dynsym_index = &dynsym - section_headers_.data();
+    for (auto& section : section_headers_) {
+        if (section.sh_link != dynsym_index) continue;
+        if (section.sh_type != SHT_GNU_HASH and section.sh_type != SHT_HASH) continue;
+        if (section.sh_offset > file_size_ or
+            section.sh_size > file_size_ - section.sh_offset) continue;
+
+        // a table whose header doesn't fit in its section is left out,
+        // and name lookups use the name index instead
+        span<const std::byte> contents{ data_ + section.sh_offset, section.sh_size };
+        auto word = [&](std::size_t i) {
+            return from_bytes<std::uint32_t>(contents.begin() + i * sizeof(std::uint32_t));
+        };
+        std::uint64_t n_words = section.sh_size / sizeof(std::uint32_t);
+        if (section.sh_type == SHT_GNU_HASH) {
+            // buckets, symbol offset, bloom size and shift, then 64 bit
+            // bloom words, buckets and chains
+            if (n_words >= 4 and word(0) != 0 and word(2) != 0 and word(3) < 32 and
+                4 + 2 * std::uint64_t(word(2)) + word(0) <= n_words) {
+                gnu_hash_ = contents;
+            }
+        }
+        else if (n_words >= 2 and word(0) != 0 and
+            2 + std::uint64_t(word(0)) + word(1) <= n_words) {
+            sysv_hash_ = contents;
+        }
+    }
+}
+
+namespace {
+    // the hash functions the dynamic linker uses for .gnu.hash and .hash
+    std::uint32_t gnu_hash(std::string_view name) {
+        std::uint32_t hash = 5381;
+        for (unsigned char c : name) hash = hash * 33 + c;
+        return hash;
+    }
 
-        auto demangled_name = abi::__cxa_demangle(
-			mangled_name.data(), nullptr, nullptr, &demangle_status
-        );
-        
-        if (demangle_status == 0) {
-            symbol_name_map_.insert({demangled_name, &symbol});
-            free(demangled_name);
+    std::uint32_t sysv_hash(std::string_view name) {
+        std::uint32_t hash = 0;
+        for (unsigned char c : name) {
+            hash = (hash << 4) + c;
+            auto high = hash & 0xf0000000;
+            if (high) hash ^= high >> 24;
+            hash &= ~high;
         }
-        symbol_name_map_.insert({ mangled_name, &symbol });
-    
-        if (symbol.st_value != 0 and symbol.st_name != 0 and 
-            symbol.st_info != STT_TLS) 
-        {
-            auto addr_range = std::pair(
-                file_addr{*this, symbol.st_value},
-                file_addr{*this, symbol.st_value + symbol.st_size}
-            );
-            
-            symbol_addr_map_.insert({addr_range, &symbol});
+        return hash;
+    }
+
+    std::uint32_t name_hash(std::string_view name) {
+        return static_cast<std::uint32_t>(std::hash<std::string_view>{}(name));
+    }
+
+    template <class Index>
+    auto entries_with_hash(const Index& index, std::uint32_t hash) {
+        auto begin = std::lower_bound(index.begin(), index.end(), hash,
+            [](auto& entry, auto hash) { return entry.hash < hash; });
+        auto end = std::upper_bound(begin, index.end(), hash,
+            [](auto hash, auto& entry) { return hash < entry.hash; });
+        return std::pair(begin, end);
+    }
+
+    // writes sorted out in Eytzinger order to tree[k] and its subtrees
+    std::size_t to_eytzinger(const std::vector<std::uint32_t>& sorted,
+        std::vector<std::uint32_t>& tree, std::size_t i = 0, std::size_t k = 1) {
+        if (k < tree.size()) {
+            i = to_eytzinger(sorted, tree, i, 2 * k);
+            tree[k] = sorted[i++];
+            i = to_eytzinger(sorted, tree, i, 2 * k + 1);
         }
+        return i;
     }
 }
 
-std::vector<const Elf64_Sym*> sdb::elf::get_symbols_by_name(std::string_view name) const {
-    auto [begin, end] = symbol_name_map_.equal_range(name);
+void sdb::elf::build_symbol_maps() const {
+    std::call_once(symbol_maps_once_, [this] {
+        std::vector<std::uint32_t> by_address;
+        symbol_name_index_.reserve(symbol_table_.size());
+        for (std::uint32_t i = 0; i < symbol_table_.size(); ++i) {
+            auto& symbol = symbol_table_[i];
+            symbol_name_index_.push_back({ name_hash(get_string(symbol.st_name)), i });
+
+            if (symbol.st_value != 0 and symbol.st_name != 0 and
+                ELF64_ST_TYPE(symbol.st_info) != STT_TLS) {
+                by_address.push_back(i);
+            }
+        }
+        std::sort(symbol_name_index_.begin(), symbol_name_index_.end(),
+            [](auto& lhs, auto& rhs) {
+                return std::tie(lhs.hash, lhs.symbol) < std::tie(rhs.hash, rhs.symbol);
+            });
+
+        // aliases share an address. the largest one wins, since size 0
+        // aliases would hide the addresses inside the function, and then
+        // the first in the table
+        auto address_of = [&](auto i) { return symbol_table_[i].st_value; };
+        std::stable_sort(by_address.begin(), by_address.end(),
+            [&](auto lhs, auto rhs) {
+                auto& l = symbol_table_[lhs];
+                auto& r = symbol_table_[rhs];
+                return std::tie(l.st_value, r.st_size) < std::tie(r.st_value, l.st_size);
+            });
+        by_address.erase(std::unique(by_address.begin(), by_address.end(),
+            [&](auto lhs, auto rhs) { return address_of(lhs) == address_of(rhs); }),
+            by_address.end());
+
+        symbol_address_index_.resize(by_address.size() + 1);
+        to_eytzinger(by_address, symbol_address_index_);
+    });
+}
 
-    std::vector<const Elf64_Sym*> ret;
-    std::transform(begin, end, std::back_inserter(ret), [](auto& pair) {
-        return pair.second;
+void sdb::elf::demangle_symbol_names() const {
+    std::call_once(demangle_once_, [this] {
+        // only C++ names are mangled
+        std::vector<std::uint32_t> mangled;
+        for (std::uint32_t i = 0; i < symbol_table_.size(); ++i) {
+            if (get_string(symbol_table_[i].st_name).substr(0, 2) == "_Z") {
+                mangled.push_back(i);
+            }
+        }
+
+        // each batch demangles into its own buffer, which are then
+        // joined into one that the index refers to
+        struct batch {
+            std::string names;
+            std::vector<demangled_name_entry> entries;
+        };
+        constexpr std::size_t batch_size = 1024;
+        std::vector<batch> batches((mangled.size() + batch_size - 1) / batch_size);
+
+        parallel_for(batches.size(), [&](std::size_t i) {
+            auto& batch = batches[i];
+            char* buffer = nullptr;
+            std::size_t buffer_size = 0;
+            auto last = std::min(mangled.size(), (i + 1) * batch_size);
+            for (auto j = i * batch_size; j < last; ++j) {
+                int status;
+                auto demangled = abi::__cxa_demangle(
+                    get_string(symbol_table_[mangled[j]].st_name).data(),
+                    buffer, &buffer_size, &status);
+                if (status != 0) continue;
+
+                buffer = demangled;
+                std::string_view name(demangled);
+                batch.entries.push_back({ name_hash(name), mangled[j],
+                    static_cast<std::uint32_t>(batch.names.size()) });
+                batch.names += name;
+                batch.names += '\0';
+            }
+            free(buffer);
+        });
+
+        std::size_t total = 0;
+        for (auto& batch : batches) total += batch.names.size();
+        demangled_names_.reserve(total);
+        for (auto& batch : batches) {
+            auto base = static_cast<std::uint32_t>(demangled_names_.size());
+            for (auto entry : batch.entries) {
+                entry.name += base;
+                demangled_name_index_.push_back(entry);
+            }
+            demangled_names_ += batch.names;
+        }
+        std::sort(demangled_name_index_.begin(), demangled_name_index_.end(),
+            [](auto& lhs, auto& rhs) {
+                return std::tie(lhs.hash, lhs.symbol) < std::tie(rhs.hash, rhs.symbol);
+            });
     });
+}
+
+bool sdb::elf::get_dynamic_symbols_by_name(
+    std::string_view name, std::vector<const Elf64_Sym*>& ret) const {
+    auto word = [](const std::byte* table, std::size_t i) {
+        return from_bytes<std::uint32_t>(table + i * sizeof(std::uint32_t));
+    };
+
+    // the headers were checked against the sections when they were
+    // found, but the indices in them could still be out of range. then
+    // whatever was found is dropped and the caller uses the name index
+    auto first_found = ret.size();
+    auto give_up = [&] {
+        ret.resize(first_found);
+        return false;
+    };
+
+    if (gnu_hash_.size() != 0) {
+        auto table = gnu_hash_.begin();
+        auto n_buckets = word(table, 0);
+        auto symbol_offset = word(table, 1);
+        auto bloom_size = word(table, 2);
+        auto bloom_shift = word(table, 3);
+        auto bloom = table + 4 * sizeof(std::uint32_t);
+        auto buckets = bloom + bloom_size * sizeof(std::uint64_t);
+        auto chains = buckets + n_buckets * sizeof(std::uint32_t);
+        auto n_chains = (gnu_hash_.end() - chains) / sizeof(std::uint32_t);
+        auto hash = gnu_hash(name);
+
+        // two bits per name in a bloom filter rule out most misses
+        auto bloom_word = from_bytes<std::uint64_t>(
+            bloom + (hash / 64 % bloom_size) * sizeof(std::uint64_t));
+        auto mask = (std::uint64_t(1) << (hash % 64)) |
+            (std::uint64_t(1) << ((hash >> bloom_shift) % 64));
+        if ((bloom_word & mask) != mask) return true;
+
+        // chains hold the hashes of the symbols from symbol_offset on,
+        // with the low bit set on the last one of each bucket. empty
+        // buckets are 0
+        auto i = word(buckets, hash % n_buckets);
+        if (i < symbol_offset) return true;
+        for (;; ++i) {
+            if (i >= symbol_table_.size() or i - symbol_offset >= n_chains) {
+                return give_up();
+            }
+            auto chain_hash = word(chains, i - symbol_offset);
+            auto& symbol = symbol_table_[i];
+            if ((chain_hash | 1) == (hash | 1) and get_string(symbol.st_name) == name) {
+                ret.push_back(&symbol);
+            }
+            if (chain_hash & 1) break;
+        }
+        return true;
+    }
+
+    if (sysv_hash_.size() != 0) {
+        auto table = sysv_hash_.begin();
+        auto n_buckets = word(table, 0);
+        auto n_chains = word(table, 1);
+        auto buckets = table + 2 * sizeof(std::uint32_t);
+        auto chains = buckets + n_buckets * sizeof(std::uint32_t);
+
+        // unlike .gnu.hash this also has undefined symbols, which
+        // are skipped so both tables give the same answers. a chain
+        // longer than the table has a cycle
+        std::uint32_t length = 0;
+        for (auto i = word(buckets, sysv_hash(name) % n_buckets);
+             i != STN_UNDEF; i = word(chains, i)) {
+            if (i >= n_chains or i >= symbol_table_.size() or ++length > n_chains) {
+                return give_up();
+            }
+            auto& symbol = symbol_table_[i];
+            if (symbol.st_shndx != SHN_UNDEF and get_string(symbol.st_name) == name) {
+                ret.push_back(&symbol);
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+std::vector<const Elf64_Sym*> sdb::elf::get_symbols_by_name(std::string_view name) const {
+    std::vector<const Elf64_Sym*> ret;
+    auto hash = name_hash(name);
+
+    if (!get_dynamic_symbols_by_name(name, ret)) {
+        build_symbol_maps();
+        auto [begin, end] = entries_with_hash(symbol_name_index_, hash);
+        for (auto it = begin; it != end; ++it) {
+            auto& symbol = symbol_table_[it->symbol];
+            if (get_string(symbol.st_name) == name) ret.push_back(&symbol);
+        }
+    }
+
+    // demangled names always have a scope, parameters, template
+    // arguments or a prefix like "vtable for"
+    if (name.find_first_of(":(< ") == std::string_view::npos) return ret;
+
+    demangle_symbol_names();
+    auto [demangled_begin, demangled_end] = entries_with_hash(demangled_name_index_, hash);
+    for (auto it = demangled_begin; it != demangled_end; ++it) {
+        if (std::string_view(demangled_names_.data() + it->name) == name) {
+            ret.push_back(&symbol_table_[it->symbol]);
+        }
+    }
 
     return ret;
 }
 
+const Elf64_Sym* sdb::elf::symbol_at_or_before(std::uint64_t address) const {
+    build_symbol_maps();
+
+    // the last node we went right from holds the closest address below
+    std::size_t k = 1;
+    std::size_t found = 0;
+    while (k < symbol_address_index_.size()) {
+        if (symbol_table_[symbol_address_index_[k]].st_value <= address) {
+            found = k;
+            k = 2 * k + 1;
+        }
+        else {
+            k = 2 * k;
+        }
+    }
+    return found ? &symbol_table_[symbol_address_index_[found]] : nullptr;
+}
+
 std::optional<const Elf64_Sym*> sdb::elf::get_symbol_at_address(file_addr address) const {
     if (address.elf_file() != this) {
         return std::nullopt;
     }
 
-    file_addr null_addr;
-    auto it = symbol_addr_map_.find({address, null_addr});
-    if (it == end(symbol_addr_map_)) {
+    auto symbol = symbol_at_or_before(address.addr());
+    if (!symbol or symbol->st_value != address.addr()) {
         return std::nullopt;
     }
 
-    return it->second;
+    return symbol;
 }
 
 std::optional<const Elf64_Sym*> sdb::elf::get_symbol_at_address(virt_addr address) const {
@@ -201,24 +604,15 @@ std::optional<const Elf64_Sym*> sdb::elf::get_symbol_at_address(virt_addr addres
 }
 
 std::optional<const Elf64_Sym*> sdb::elf::get_symbol_containing_address(file_addr address) const {
-	if (address.elf_file() != this or symbol_addr_map_.empty())
+	if (address.elf_file() != this)
 		return std::nullopt;
 
-	file_addr null_addr;
-	auto it = symbol_addr_map_.lower_bound({ address, null_addr });
-
-	if (it != end(symbol_addr_map_)) {
-		if (auto [key, value] = *it; key.first == address) {
-			return value;
-		}
-	}
-
-	if (it == begin(symbol_addr_map_)) return std::nullopt;
+	auto symbol = symbol_at_or_before(address.addr());
+	if (!symbol) return std::nullopt;
 
-	--it;
-	if (auto [key, value] = *it;
-		key.first < address and key.second > address) {
-		return value;
+	if (symbol->st_value == address.addr() or
+		symbol->st_value + symbol->st_size > address.addr()) {
+		return symbol;
 	}
 
 	return std::nullopt;
@@ -229,13 +623,39 @@ std::optional<const Elf64_Sym*> sdb::elf::get_symbol_containing_address(virt_add
 }
 
 const sdb::elf* sdb::elf_collection::get_elf_containing_address(virt_addr address) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), address.addr(),
+        [](auto addr, auto& range) { return addr < range.low; });
+    if (it == ranges_.begin()) return nullptr;
+
+    --it;
+    return address.addr() < it->high ? it->obj : nullptr;
+}
+
+void sdb::elf_collection::notify_loaded(const elf& obj, virt_addr address) {
     for (auto& elf : elves_) {
-        if (auto section = elf->get_section_containing_address(address); section) {
-            return elf.get();
+        if (elf.get() == &obj) {
+            unindex(obj);
+            elf->notify_loaded(address);
+            index(obj);
         }
     }
+}
 
-    return nullptr;
+void sdb::elf_collection::index(const elf& obj) {
+    for (auto section : obj.loaded_sections()) {
+        loaded_range range{
+            obj.load_bias().addr() + section->sh_addr,
+            obj.load_bias().addr() + section->sh_addr + section->sh_size,
+            &obj };
+        auto it = std::upper_bound(ranges_.begin(), ranges_.end(), range.low,
+            [](auto addr, auto& r) { return addr < r.low; });
+        ranges_.insert(it, range);
+    }
+}
+
+void sdb::elf_collection::unindex(const elf& obj) {
+    ranges_.erase(std::remove_if(ranges_.begin(), ranges_.end(),
+        [&](auto& range) { return range.obj == &obj; }), ranges_.end());
 }
 
 const sdb::elf* sdb::elf_collection::get_elf_by_path(std::filesystem::path path) const {
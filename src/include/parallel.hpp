@@ -0,0 +1,120 @@
+#ifndef SDB_PARALLEL_HPP
+#define SDB_PARALLEL_HPP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace sdb {
+    // one set of worker threads shared by everything in the process, so
+    // the number of threads stays bounded however many ELFs are loaded
+    class worker_pool {
+    public:
+        static worker_pool& get();
+
+        worker_pool(const worker_pool&) = delete;
+        worker_pool& operator=(const worker_pool&) = delete;
+        ~worker_pool();
+
+        std::size_t size() const { return threads_.size(); }
+
+        void submit(std::function<void()> task);
+
+        // runs f on a worker. tasks run in the order they're submitted
+        template <class F>
+        std::future<void> run(F f) {
+            auto task = std::make_shared<std::packaged_task<void()>>(std::move(f));
+            auto ret = task->get_future();
+            submit([task] { (*task)(); });
+            return ret;
+        }
+
+    private:
+        worker_pool();
+        void work();
+
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::deque<std::function<void()>> tasks_;
+        bool stopping_ = false;
+        std::vector<std::thread> threads_;
+    };
+
+    // calls f(i) for every i in [0, count) on the calling thread and any
+    // pool workers that are free. work is handed out one index at a time,
+    // so callers that store results per index get the same output
+    // regardless of scheduling. the caller never waits on work that
+    // hasn't started, which makes nested calls from pool tasks safe.
+    // the first exception thrown is rethrown once every worker is done
+    template <class F>
+    void parallel_for(std::size_t count, F f) {
+        auto& pool = worker_pool::get();
+        auto n_cores = std::max(1u, std::thread::hardware_concurrency());
+        auto n_helpers = std::min<std::size_t>(
+            { n_cores - 1, pool.size(), count == 0 ? 0 : count - 1 });
+        if (n_helpers == 0) {
+            for (std::size_t i = 0; i < count; ++i) f(i);
+            return;
+        }
+
+        struct job {
+            std::atomic<std::size_t> next{ 0 };
+            std::size_t count;
+            F* f;
+            std::mutex mutex;
+            std::condition_variable done;
+            std::size_t running = 0;
+            bool finished = false;
+            std::exception_ptr error;
+
+            void work() {
+                std::size_t i;
+                while ((i = next++) < count) {
+                    try {
+                        (*f)(i);
+                    }
+                    catch (...) {
+                        std::lock_guard lock(mutex);
+                        if (!error) error = std::current_exception();
+                        next = count;
+                    }
+                }
+            }
+        };
+        auto shared = std::make_shared<job>();
+        shared->count = count;
+        shared->f = &f;
+
+        for (std::size_t i = 0; i < n_helpers; ++i) {
+            pool.submit([shared] {
+                {
+                    std::lock_guard lock(shared->mutex);
+                    if (shared->finished) return;
+                    ++shared->running;
+                }
+                shared->work();
+                std::lock_guard lock(shared->mutex);
+                --shared->running;
+                shared->done.notify_all();
+            });
+        }
+        shared->work();
+
+        // helpers that start from here on find nothing left to do
+        std::unique_lock lock(shared->mutex);
+        shared->finished = true;
+        shared->done.wait(lock, [&] { return shared->running == 0; });
+        if (shared->error) std::rethrow_exception(shared->error);
+    }
+}
+
+#endif
@@ -0,0 +1,48 @@
+#include <sys/uio.h>
+#include <algorithm>
+#include <libsdb/memory_snapshot.hpp>
+#include <libsdb/process.hpp>
+#include <libsdb/bit.hpp>
+
+sdb::memory_snapshot::memory_snapshot(
+    const process& proc, virt_addr start, std::size_t initial_size)
+    : proc_(&proc), start_(start), next_size_(initial_size) {}
+
+std::uint64_t sdb::memory_snapshot::read_u64(virt_addr address) {
+    ++reads_;
+
+    if (address >= start_) {
+        auto offset = address.addr() - start_.addr();
+        auto end = offset + sizeof(std::uint64_t);
+        if (end > data_.size() and end <= max_size_ and !exhausted_) {
+            extend(end);
+        }
+        if (end <= data_.size()) {
+            return from_bytes<std::uint64_t>(data_.data() + offset);
+        }
+    }
+
+    ++syscalls_;
+    return proc_->read_memory_as<std::uint64_t>(address);
+}
+
+void sdb::memory_snapshot::extend(std::size_t end) {
+    // grow geometrically so a deep stack takes a handful of reads
+    auto old_size = data_.size();
+    auto size = std::min(std::max(end, old_size + next_size_), max_size_);
+    next_size_ *= 2;
+    data_.resize(size);
+
+    iovec local_desc{ data_.data() + old_size, size - old_size };
+    iovec remote_desc{
+        reinterpret_cast<void*>(start_.addr() + old_size), size - old_size };
+
+    // a short read means the next page isn't mapped, which is the top
+    // of the stack as far as we're concerned
+    ++syscalls_;
+    auto read = process_vm_readv(proc_->pid(), &local_desc, /*liovcnt=*/1,
+        &remote_desc, /*riovcnt=*/1, /*flags=*/0);
+    auto n_read = read < 0 ? 0 : static_cast<std::size_t>(read);
+    if (n_read < size - old_size) exhausted_ = true;
+    data_.resize(old_size + n_read);
+}
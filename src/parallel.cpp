@@ -0,0 +1,45 @@
+#include <parallel.hpp>
+
+sdb::worker_pool& sdb::worker_pool::get() {
+    static worker_pool pool;
+    return pool;
+}
+
+sdb::worker_pool::worker_pool() {
+    // the thread that calls parallel_for works too
+    auto n_threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    for (std::size_t i = 0; i < n_threads; ++i) {
+        threads_.emplace_back([this] { work(); });
+    }
+}
+
+sdb::worker_pool::~worker_pool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (auto& thread : threads_) thread.join();
+}
+
+void sdb::worker_pool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    ready_.notify_one();
+}
+
+void sdb::worker_pool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            ready_.wait(lock, [this] { return stopping_ or !tasks_.empty(); });
+            if (stopping_) return;
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -8,6 +8,7 @@
 #include <libsdb/bit.hpp>
 #include <libsdb/target.hpp>
 #include <fstream>
+#include <sstream>
 #include <elf.h>
 
 namespace {
@@ -132,17 +133,30 @@ sdb::process::attach(pid_t pid) {
 sdb::process::~process() {
     if (pid_ != 0) {
         int status;
+        std::vector<pid_t> still_traced;
         if (is_attached_) {
             if (state_ == process_state::running) {
                 kill(pid_, SIGSTOP);
                 waitpid(pid_, &status, 0);
             }
-            ptrace(PTRACE_DETACH, pid_, nullptr, nullptr);
+            // threads we still trace can't be reaped by anyone else,
+            // including ones cloned since we last looked
+            std::error_code ec;
+            auto tasks = "/proc/" + std::to_string(pid_) + "/task";
+            for (auto& entry : std::filesystem::directory_iterator(tasks, ec)) {
+                auto tid = std::stoi(entry.path().filename().string());
+                if (ptrace(PTRACE_DETACH, tid, nullptr, nullptr) < 0 and tid != pid_) {
+                    still_traced.push_back(tid);
+                }
+            }
             kill(pid_, SIGCONT);
         }
 
         if (terminate_on_end_) {
             kill(pid_, SIGKILL);
+            // detaching fails for threads that weren't stopped, and the
+            // leader can't be reaped until they've been
+            for (auto tid : still_traced) waitpid(tid, &status, __WALL);
             waitpid(pid_, &status, 0);
         }
     }
@@ -344,8 +358,9 @@ sdb::process::handle_signal(stop_reason reason, bool is_main_stop) {
                 breakpoint_sites_.get_by_address(instr_begin).is_enabled()) {
                 set_pc(instr_begin, tid);
 
+                // sites of disabled breakpoints are only armed while stepping
                 auto& bp = breakpoint_sites_.get_by_address(instr_begin);
-                if (bp.parent_) {
+                if (bp.parent_ and bp.parent_->is_enabled()) {
                     bool should_restart = bp.parent_->notify_hit();
                     if (should_restart and is_main_stop) {
                         return std::nullopt;
@@ -411,10 +426,10 @@ sdb::stop_reason sdb::process::wait_on_signal(pid_t to_wait) {
 }
 
 void sdb::process::read_all_registers(pid_t tid) {
-    if (ptrace(PTRACE_GETREGS, tid, nullptr, &get_registers().data_.regs) < 0) {
+    if (ptrace(PTRACE_GETREGS, tid, nullptr, &get_registers(tid).data_.regs) < 0) {
         error::send_errno("Could not read GPR registers");
     }
-    if (ptrace(PTRACE_GETFPREGS, tid, nullptr, &get_registers().data_.i387) < 0) {
+    if (ptrace(PTRACE_GETFPREGS, tid, nullptr, &get_registers(tid).data_.i387) < 0) {
         error::send_errno("Could not read FPR registers");
     }
     for (int i = 0; i < 8; ++i) {
@@ -559,6 +574,8 @@ void sdb::process::write_memory(virt_addr address, span<const std::byte> data) {
 
         written += 8;
     }
+
+    if (target_) target_->notify_memory_write();
 }
 
 int sdb::process::set_hardware_stoppoint(virt_addr address, stoppoint_mode mode, std::size_t size) {
@@ -737,6 +754,34 @@ std::unordered_map<int, std::uint64_t> sdb::process::get_auxv() const {
 	return ret;
 }
 
+std::vector<sdb::memory_region> sdb::process::get_memory_map() const {
+    auto path = "/proc/" + std::to_string(pid_) + "/maps";
+    std::ifstream maps(path);
+
+    std::vector<memory_region> ret;
+    std::string line;
+    while (std::getline(maps, line)) {
+        // start-end perms offset dev inode [path]
+        std::istringstream fields(line);
+        std::string range, perms, offset, dev, inode;
+        fields >> range >> perms >> offset >> dev >> inode;
+
+        auto dash = range.find('-');
+        if (dash == std::string::npos or perms.size() < 3) continue;
+
+        memory_region region;
+        region.start = virt_addr{ std::stoull(range.substr(0, dash), nullptr, 16) };
+        region.end = virt_addr{ std::stoull(range.substr(dash + 1), nullptr, 16) };
+        region.readable = perms[0] == 'r';
+        region.writable = perms[1] == 'w';
+        region.executable = perms[2] == 'x';
+        std::getline(fields >> std::ws, region.path);
+        ret.push_back(std::move(region));
+    }
+
+    return ret;
+}
+
 void sdb::process::populate_existing_threads() {
     auto path = "/proc/" + std::to_string(pid_) + "/task";
     for (auto& entry : std::filesystem::directory_iterator(path)) {
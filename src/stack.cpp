@@ -1,20 +1,22 @@
 #include <libsdb/stack.hpp>
 #include <libsdb/target.hpp>
+#include <libsdb/memory_snapshot.hpp>
+#include <libsdb/error.hpp>
 
 std::vector<sdb::die> sdb::stack::inline_stack_at_pc() const {
-    auto pc = target_->get_pc_file_address(tid_);
-    if (!pc.elf_file()) {
-        return {};
-    }
-
-    return pc.elf_file()->get_dwarf().inline_stack_at_address(pc);
+    return target_->inline_stack_at_pc(tid_);
 }
 
 void sdb::stack::reset_inline_height() {
+    sync();
+    compute_inline_height();
+}
+
+void sdb::stack::compute_inline_height() const {
     auto stack = inline_stack_at_pc();
 
     inline_height_ = 0;
-    auto pc = target_->get_pc_file_address();
+    auto pc = target_->get_pc_file_address(tid_);
     // go from deepest element of stack to beggining or 
     // a frame which execution is not at start
     for (auto it = stack.rbegin(); 
@@ -26,83 +28,295 @@ void sdb::stack::reset_inline_height() {
 
 sdb::span<const sdb::stack_frame>
 sdb::stack::frames() const {
-    return { frames_.data() + inline_height_ , frames_.size() - inline_height_ };
+    return frames(frames_.max_size());
+}
+
+sdb::span<const sdb::stack_frame>
+sdb::stack::frames(std::size_t max_frames) const {
+    sync();
+    auto wanted = inline_height_ + max_frames;
+    unwind_until(wanted < max_frames ? frames_.max_size() : wanted);
+    auto available = frames_.size() > inline_height_ ? frames_.size() - inline_height_ : 0;
+    return { frames_.data() + inline_height_, std::min(available, max_frames) };
+}
+
+const sdb::stack_frame& sdb::stack::current_frame() const {
+    sync();
+    unwind_until(current_frame_ + 1);
+    return frames_[current_frame_];
 }
 
 const sdb::registers& sdb::stack::regs() const {
-    return frames_[current_frame_].regs;
+    auto& frame = current_frame();
+    if (selected_regs_ and selected_frame_ == current_frame_) {
+        return *selected_regs_;
+    }
+
+    auto regs = base_regs_;
+    for (std::size_t i = 1; i <= current_frame_; ++i) {
+        frames_[i].regs.apply(regs);
+    }
+    regs.write_by_id(register_id::rip, frame.pc.addr(), false);
+    regs.set_cfa(frame.cfa);
+
+    selected_regs_ = std::move(regs);
+    selected_frame_ = current_frame_;
+    return *selected_regs_;
+}
+
+void sdb::register_delta::apply(registers& regs) const {
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (changed & (1 << i)) regs.write_by_id(ids[i], values[i], false);
+        if (undefined & (1 << i)) regs.undefine(ids[i]);
+    }
+}
+
+sdb::stack::frame_summary sdb::stack::summarize_frames(std::size_t n) const {
+    frame_summary ret;
+    ret.innermost = frames(n);
+
+    // walk the rest from a copy of the cursor, keeping only the tail
+    std::vector<stack_frame> tail;
+    std::size_t dropped = 0;
+    auto cursor = cursor_;
+    while (unwind_next(cursor, tail)) {
+        if (tail.size() > 2 * n + 64) {
+            auto excess = tail.size() - n;
+            tail.erase(tail.begin(), tail.begin() + excess);
+            dropped += excess;
+        }
+    }
+
+    auto stored = frames_.size() > inline_height_ ? frames_.size() - inline_height_ : 0;
+    ret.total = stored + dropped + tail.size();
+
+    // the last n that aren't already innermost ones
+    auto wanted = std::min(n, ret.total - ret.innermost.size());
+    auto from_tail = std::min(wanted, tail.size());
+    auto from_stored = wanted - from_tail;
+    ret.outermost.assign(frames_.end() - from_stored, frames_.end());
+    ret.outermost.insert(ret.outermost.end(), tail.end() - from_tail, tail.end());
+    return ret;
+}
+
+void sdb::stack::up() {
+    sync();
+    unwind_until(current_frame_ + 2);
+    if (current_frame_ + 1 < frames_.size()) ++current_frame_;
 }
 
+void sdb::stack::down() {
+    sync();
+    if (current_frame_ > inline_height_) --current_frame_;
+}
 
 sdb::virt_addr sdb::stack::get_pc() const {
-    return virt_addr {
-        regs().read_by_id_as<std::uint64_t>(sdb::register_id::rip)
-    };
+    return current_frame().pc;
 }
 
 void sdb::stack::create_base_frame(
-    const sdb::registers& regs,
+    std::vector<stack_frame>& out,
     const std::vector<sdb::die> inline_stack,
     file_addr pc,
-    bool inlined) 
+    bool inlined) const
 {
     auto backtrace_pc = pc.to_virt_addr();
     auto line_entry = pc.elf_file()->get_dwarf().line_entry_at_address(pc);
     if (line_entry != line_table::iterator{})
         backtrace_pc = line_entry->address.to_virt_addr();
 
-    frames_.push_back({regs, backtrace_pc, inline_stack.back(), inlined});
-    frames_.back().location = source_location{
+    out.push_back({{}, {}, {}, backtrace_pc, inline_stack.back(), inlined});
+    out.back().location = source_location{
         line_entry->file_entry, line_entry->line
     };
 }
 
 void sdb::stack::create_inline_stack_frames(
-    const sdb::registers& regs,
+    std::vector<stack_frame>& out,
     const std::vector<sdb::die> inline_stack,
     file_addr pc
-) {
+) const {
     for (auto it = inline_stack.rbegin() + 1; it != inline_stack.rend(); ++it) {
         auto inlined_pc = std::prev(it)->low_pc().to_virt_addr();
-        frames_.push_back(stack_frame{regs, inlined_pc, *it});
-        frames_.back().inlined = std::next(it) != inline_stack.rend();
-        frames_.back().location = std::prev(it)->location();
+        out.push_back(stack_frame{{}, {}, {}, inlined_pc, *it});
+        out.back().inlined = std::next(it) != inline_stack.rend();
+        out.back().location = std::prev(it)->location();
     }
 }
 
 void sdb::stack::unwind() {
-    reset_inline_height();
+    epoch_ = 0;
+    sync();
+    unwind_until(frames_.max_size());
+}
+
+void sdb::stack::sync() const {
+    auto epoch = target_->stop_epoch();
+    if (epoch_ == epoch) return;
+    epoch_ = epoch;
+
+    frames_.clear();
+    compute_inline_height();
     current_frame_ = inline_height_;
+    selected_regs_.reset();
 
-    auto virt_pc = target_->get_process().get_pc(tid_);
-    auto file_pc = target_->get_pc_file_address(tid_);
     auto& proc = target_->get_process();
-    auto regs = proc.get_registers(tid_);
+    base_regs_ = proc.get_registers(tid_);
+    cursor_ = unwind_cursor{ base_regs_, {}, proc.get_pc(tid_) };
+    stack_memory_ = std::make_unique<memory_snapshot>(proc,
+        virt_addr{ base_regs_.read_by_id_as<std::uint64_t>(register_id::rsp) });
+    stack_region_.reset();
+}
 
-    frames_.clear();
+void sdb::stack::unwind_until(std::size_t n_frames) const {
+    while (frames_.size() < n_frames and unwind_next());
+}
 
-    // unwind until we hit frame that lives outside our ELF file
-    auto elf = file_pc.elf_file();
-    if (!elf) return;
+bool sdb::stack::unwind_next(
+    unwind_cursor& cursor, std::vector<stack_frame>& out) const {
+    if (cursor.done) return false;
 
-    while (virt_pc.addr() != 0 and elf) {
-        // create stack_frame objects and unwind another frame
-        auto& dwarf = elf->get_dwarf();
-        auto inline_stack = dwarf.inline_stack_at_address(file_pc);
-        if (inline_stack.empty()) return;
+    auto pc = cursor.pc.to_file_addr(target_->get_elves());
+    auto elf = pc.elf_file();
 
+    // create stack_frame objects and unwind another frame
+    auto first = out.size();
+    try {
+        auto inline_stack = elf ?
+            elf->get_dwarf().inline_stack_at_address(pc) : std::vector<die>{};
         if (inline_stack.size() > 1) {
-            create_base_frame(regs, inline_stack, file_pc, true);
-            create_inline_stack_frames(regs, inline_stack, file_pc);
-        } else {
-            create_base_frame(regs, inline_stack, file_pc, false);
+            create_base_frame(out, inline_stack, pc, true);
+            create_inline_stack_frames(out, inline_stack, pc);
+        } 
+        else if (inline_stack.size() == 1) {
+            create_base_frame(out, inline_stack, pc, false);
         }
+    }
+    catch (error&) {
+        out.erase(out.begin() + first, out.end());
+    }
+    if (out.size() == first) {
+        // no usable debug info, only the symbol table can name this one
+        out.push_back(stack_frame{
+            {}, {}, {}, cursor.pc, die{ nullptr }, false, { nullptr, 0 } });
+    }
+
+    // inline frames share their physical frame's registers
+    auto& regs = cursor.regs;
+    auto rip = regs.read_by_id_as<std::uint64_t>(register_id::rip);
+    for (auto i = first; i < out.size(); ++i) {
+        out[i].pc = virt_addr{ rip };
+        out[i].regs = cursor.delta;
+    }
 
-        regs = dwarf.cfi().unwind(proc, file_pc, frames_.back().regs);
-        virt_pc = virt_addr{
-            regs.read_by_id_as<std::uint64_t>(register_id::rip) - 1
+    // this frame is the last one unless its caller can be found
+    cursor.done = true;
+    try {
+        auto rsp = regs.read_by_id_as<std::uint64_t>(register_id::rsp);
+        auto set_cfa = [&](virt_addr cfa) {
+            for (auto i = first; i < out.size(); ++i) out[i].cfa = cfa;
         };
-        file_pc = virt_pc.to_file_addr(target_->get_elves());
-        elf = file_pc.elf_file();
+
+        registers caller;
+        auto unwound = false;
+        // some FDEs, like those of signal trampolines, recover registers
+        // with expressions the CFI interpreter doesn't evaluate
+        try {
+            if (elf and elf->get_dwarf().cfi().covers(pc)) {
+                caller = elf->get_dwarf().cfi().unwind(*stack_memory_, pc, regs);
+                unwound = true;
+            }
+        }
+        catch (error&) {}
+        if (unwound) {
+            set_cfa(regs.cfa());
+            if (caller.is_undefined(register_id::rip)) return true;
+        }
+        else {
+            // nothing else knows this code, guess that it keeps frame
+            // pointers
+            auto caller_rip = rip;
+            auto caller_rsp = rsp;
+            auto rbp = regs.read_by_id_as<std::uint64_t>(register_id::rbp);
+            if (!unwind_frame_pointer(caller_rip, caller_rsp, rbp)) return true;
+
+            set_cfa(virt_addr{ caller_rsp });
+            caller = regs;
+            caller.write_by_id(register_id::rip, caller_rip, false);
+            caller.write_by_id(register_id::rsp, caller_rsp, false);
+            caller.write_by_id(register_id::rbp, rbp, false);
+            for (auto id : { register_id::rbx, register_id::r12, register_id::r13,
+                register_id::r14, register_id::r15 }) {
+                caller.undefine(id);
+            }
+        }
+
+        // the stack only grows one way, anything else is garbage
+        auto return_address = caller.read_by_id_as<std::uint64_t>(register_id::rip);
+        auto caller_rsp = caller.read_by_id_as<std::uint64_t>(register_id::rsp);
+        if (return_address == 0 or caller_rsp <= rsp) return true;
+
+        register_delta delta;
+        for (std::size_t i = 0; i < delta.ids.size(); ++i) {
+            auto id = delta.ids[i];
+            if (caller.is_undefined(id)) {
+                if (!regs.is_undefined(id)) delta.undefined |= 1 << i;
+                continue;
+            }
+            auto value = caller.read_by_id_as<std::uint64_t>(id);
+            if (regs.is_undefined(id) or regs.read_by_id_as<std::uint64_t>(id) != value) {
+                delta.changed |= 1 << i;
+                delta.values[i] = value;
+            }
+        }
+
+        cursor = unwind_cursor{ std::move(caller), delta, virt_addr{ return_address - 1 } };
+    }
+    catch (error&) {}
+    return true;
+}
+
+bool sdb::stack::unwind_frame_pointer(
+    std::uint64_t& rip, std::uint64_t& rsp, std::uint64_t& rbp) const {
+    if (!stack_region_) {
+        auto regions = target_->get_process().get_memory_map();
+        auto it = std::find_if(regions.begin(), regions.end(),
+            [&](auto& region) { return region.contains(virt_addr{ rsp }); });
+        stack_region_ = it != regions.end() ? *it : memory_region{};
+    }
+
+    // the frame record is the saved rbp followed by the return address
+    auto record = virt_addr{ rbp };
+    if (rbp % 8 != 0 or rbp < rsp or
+        !stack_region_->contains(record) or
+        !stack_region_->contains(record + 15)) {
+        return false;
+    }
+
+    auto return_address = stack_memory_->read_u64(record + 8);
+    if (return_address == 0) return false;
+
+    rip = return_address;
+    rsp = rbp + 16;
+    rbp = stack_memory_->read_u64(record);
+    return true;
+}
+
+std::vector<sdb::virt_addr>
+sdb::stack::frame_pointer_backtrace(std::size_t max_frames) const {
+    sync();
+
+    std::vector<virt_addr> ret;
+    if (max_frames == 0) return ret;
+
+    auto& regs = target_->get_process().get_registers(tid_);
+    auto rip = regs.read_by_id_as<std::uint64_t>(register_id::rip);
+    auto rsp = regs.read_by_id_as<std::uint64_t>(register_id::rsp);
+    auto rbp = regs.read_by_id_as<std::uint64_t>(register_id::rbp);
+
+    ret.push_back(virt_addr{ rip });
+    while (ret.size() < max_frames and unwind_frame_pointer(rip, rsp, rbp)) {
+        ret.push_back(virt_addr{ rip });
     }
-}
\ No newline at end of file
+    return ret;
+}
@@ -6,6 +6,7 @@
 #include <libsdb/bit.hpp>
 #include <cxxabi.h>
 #include <fstream>
+#include <parallel.hpp>
 
 namespace {
     std::filesystem::path dump_vdso(
@@ -25,22 +26,33 @@ namespace {
     }
 
     std::unique_ptr<sdb::elf> create_loaded_elf(
-        const sdb::process& proc, const std::filesystem::path& path) {
+        const sdb::process& proc, const std::filesystem::path& path,
+        sdb::elf_options options) {
         auto auxv = proc.get_auxv();
-        auto obj = std::make_unique<sdb::elf>(path);
+        auto obj = std::make_unique<sdb::elf>(path, options);
         obj->notify_loaded(
             sdb::virt_addr(auxv[AT_ENTRY] - obj->get_header().e_entry));
         return obj;
     }
+
+    // a source line may be split over several rows, by column or
+    // because it has more than one basic block
+    bool same_line(sdb::line_table::iterator lhs, sdb::line_table::iterator rhs) {
+        if (lhs == sdb::line_table::iterator{} or rhs == sdb::line_table::iterator{}) {
+            return lhs == rhs;
+        }
+        return lhs->file_entry == rhs->file_entry and lhs->line == rhs->line;
+    }
 }
 
 std::unique_ptr<sdb::target>
 sdb::target::launch(
-    std::filesystem::path path, std::optional<int> stdout_replacement) {
+    std::filesystem::path path, std::optional<int> stdout_replacement,
+    elf_options options) {
     auto proc = process::launch(path, true, stdout_replacement);
-    auto obj = create_loaded_elf(*proc, path);
+    auto obj = create_loaded_elf(*proc, path, options);
     auto tgt = std::unique_ptr<target>(
-        new target(std::move(proc), std::move(obj)));
+        new target(std::move(proc), std::move(obj), options));
     tgt->get_process().set_target(tgt.get());
     auto entry_point = virt_addr{ tgt->get_process().get_auxv()[AT_ENTRY] };
     auto& entry_bp = tgt->create_address_breakpoint(entry_point, false, true);
@@ -53,13 +65,14 @@ sdb::target::launch(
 }
 
 std::unique_ptr<sdb::target>
-sdb::target::attach(pid_t pid) {
+sdb::target::attach(pid_t pid, elf_options options) {
     auto proc = sdb::process::attach(pid);
 
     auto elf_path = std::filesystem::path("/proc") / std::to_string(pid) / "exe";
-    auto obj = create_loaded_elf(*proc, elf_path);
+    auto obj = create_loaded_elf(*proc, elf_path, options);
 
-    auto tgt = std::unique_ptr<target>(new target(std::move(proc), std::move(obj)));
+    auto tgt = std::unique_ptr<target>(
+        new target(std::move(proc), std::move(obj), options));
     tgt->get_process().set_target(tgt.get());
     tgt->resolve_dynamic_linker_rendezvous();
 
@@ -67,11 +80,60 @@ sdb::target::attach(pid_t pid) {
 }
 
 sdb::file_addr sdb::target::get_pc_file_address(std::optional<pid_t> otid) const {
-    return process_->get_pc(otid).to_file_addr(elves_);
+    auto tid = otid.value_or(process_->current_thread());
+    auto pc = process_->get_pc(tid);
+    std::lock_guard lock(location_cache_mutex_);
+    return location_at_pc(tid, pc).file_address;
+}
+
+sdb::target::pc_location&
+sdb::target::location_at_pc(pid_t tid, virt_addr pc) const {
+    auto& location = location_cache_[tid];
+    if (location.epoch == stop_epoch_ and location.pc == pc) {
+        ++location_cache_hits_;
+        return location;
+    }
+
+    ++location_cache_misses_;
+    location = pc_location{};
+    location.epoch = stop_epoch_;
+    location.pc = pc;
+    location.file_address = pc.to_file_addr(elves_);
+    return location;
+}
+
+template <class T, class F>
+T sdb::target::cached_at_pc(std::optional<pid_t> otid,
+    std::optional<T> pc_location::* part, F resolve) const {
+    auto tid = otid.value_or(process_->current_thread());
+    auto pc = process_->get_pc(tid);
+    file_addr file_address;
+    {
+        std::lock_guard lock(location_cache_mutex_);
+        auto& location = location_at_pc(tid, pc);
+        if (location.*part) return *(location.*part);
+        file_address = location.file_address;
+    }
+
+    // DWARF lookups can be slow, don't hold up other threads for them
+    auto value = resolve(pc, file_address);
+    std::lock_guard lock(location_cache_mutex_);
+    auto& location = location_cache_[tid];
+    if (location.epoch == stop_epoch_ and location.pc == pc) {
+        location.*part = value;
+    }
+    return value;
+}
+
+void sdb::target::notify_stop(const sdb::stop_reason&) {
+    std::lock_guard lock(location_cache_mutex_);
+    ++stop_epoch_;
+    location_cache_.clear();
 }
 
-void sdb::target::notify_stop(const sdb::stop_reason& reason) {
-    threads_.at(reason.tid).frames.unwind();
+void sdb::target::notify_memory_write() {
+    std::lock_guard lock(location_cache_mutex_);
+    location_cache_.clear();
 }
 
 void sdb::target::notify_thread_lifecycle_event(const stop_reason& reason) {
@@ -98,19 +160,18 @@ sdb::stop_reason sdb::target::step_in(std::optional<pid_t> otid) {
 
     auto orig_line = line_entry_at_pc(tid);
     do {
-        auto reason = process_->step_instruction(tid);
+        auto reason = step_line_range(tid, false);
         if (!reason.is_step()) {
             thread.state->reason = reason;
             return reason;
         }
-    } while ((line_entry_at_pc(tid) == orig_line
+    } while ((same_line(line_entry_at_pc(tid), orig_line)
         or line_entry_at_pc(tid)->end_sequence)
         and line_entry_at_pc(tid) != line_table::iterator{});
 
     auto pc = get_pc_file_address(tid);
     if (pc.elf_file() != nullptr) {
-        auto& dwarf = pc.elf_file()->get_dwarf();
-        auto func = dwarf.function_containing_address(pc);
+        auto func = function_at_pc(tid);
         if (func and func->low_pc() == pc) {
             auto line = line_entry_at_pc(tid);
             if (line != line_table::iterator{}) {
@@ -128,47 +189,137 @@ sdb::stop_reason sdb::target::step_in(std::optional<pid_t> otid) {
 
 sdb::line_table::iterator
 sdb::target::line_entry_at_pc(std::optional<pid_t> otid) const {
-    auto pc = get_pc_file_address(otid);
-    if (!pc.elf_file()) return line_table::iterator();
-    auto cu = pc.elf_file()->get_dwarf().compile_unit_containing_address(pc);
-    if (!cu) return line_table::iterator();
-    return cu->lines().get_entry_by_address(pc);
+    return cached_at_pc(otid, &pc_location::line, [](auto, auto pc) {
+        auto cu = pc.elf_file() ?
+            pc.elf_file()->get_dwarf().compile_unit_containing_address(pc) : nullptr;
+        return cu ? cu->lines().get_entry_by_address(pc) : line_table::iterator();
+        });
+}
+
+std::optional<sdb::die>
+sdb::target::function_at_pc(std::optional<pid_t> otid) const {
+    return cached_at_pc(otid, &pc_location::function, [](auto, auto pc) {
+        return pc.elf_file() ?
+            pc.elf_file()->get_dwarf().function_containing_address(pc) : std::nullopt;
+        });
+}
+
+std::vector<sdb::die>
+sdb::target::inline_stack_at_pc(std::optional<pid_t> otid) const {
+    return cached_at_pc(otid, &pc_location::inline_stack, [](auto, auto pc) {
+        return pc.elf_file() ?
+            pc.elf_file()->get_dwarf().inline_stack_at_address(pc) : std::vector<die>{};
+        });
+}
+
+std::string
+sdb::target::function_name_at_pc(std::optional<pid_t> otid) const {
+    return cached_at_pc(otid, &pc_location::function_name, [this](auto pc, auto) {
+        return function_name_at_address(pc);
+        });
 }
 
 sdb::stop_reason sdb::target::run_until_address(
     virt_addr address,
     std::optional<pid_t> otid) {
     auto tid = otid.value_or(process_->current_thread());
-    breakpoint_site* breakpoint_to_remove = nullptr;
-    if (!process_->breakpoint_sites().contains_address(address)) {
-        breakpoint_to_remove = &process_->create_breakpoint_site(
-            address, false, true);
-        breakpoint_to_remove->enable();
+    return run_until_any_address({ address }, tid);
+}
+
+sdb::stop_reason sdb::target::run_until_any_address(
+    const std::vector<virt_addr>& addresses, pid_t tid) {
+    std::vector<virt_addr> breakpoints_to_remove;
+    std::vector<breakpoint_site*> sites_to_disable;
+    auto& sites = process_->breakpoint_sites();
+    for (auto address : addresses) {
+        if (!sites.contains_address(address)) {
+            process_->create_breakpoint_site(address, false, true).enable();
+            breakpoints_to_remove.push_back(address);
+        }
+        else if (!sites.enabled_stoppoint_at_address(address)) {
+            // a disabled user breakpoint, which is armed just for this run
+            auto& site = sites.get_by_address(address);
+            site.enable();
+            sites_to_disable.push_back(&site);
+        }
     }
 
-    process_->resume(otid);
+    process_->resume(tid);
     auto reason = process_->wait_on_signal(tid);
-    if (reason.is_breakpoint()
-        and process_->get_pc(tid) == address) {
+    auto pc = process_->get_pc(tid);
+    if (reason.is_breakpoint() and
+        std::find(addresses.begin(), addresses.end(), pc) != addresses.end()) {
         reason.trap_reason = trap_type::single_step;
     }
 
-    if (breakpoint_to_remove) {
-        process_->breakpoint_sites().remove_by_address(
-            breakpoint_to_remove->address());
+    for (auto address : breakpoints_to_remove) {
+        sites.remove_by_address(address);
     }
+    for (auto site : sites_to_disable) site->disable();
 
     threads_.at(tid).state->reason = reason;
     return reason;
 }
 
+// moves tid on by at least one instruction, continuing rather than single
+// stepping while it stays in the address range of its source line.
+// breakpoints go at the end of the range, the targets of direct jumps out
+// of it and every instruction whose destination isn't known up front.
+// those are stepped one at a time once reached
+sdb::stop_reason sdb::target::step_line_range(pid_t tid, bool step_over_calls) {
+    auto line = line_entry_at_pc(tid);
+    if (line == line_table::iterator{} or line->end_sequence) {
+        return process_->step_instruction(tid);
+    }
+
+    // the rows after this one that are still the same line
+    auto end = std::next(line);
+    while (!end->end_sequence and same_line(end, line)) ++end;
+
+    auto pc = process_->get_pc(tid);
+    auto low = line->address.to_virt_addr();
+    auto high = end->address.to_virt_addr();
+    disassembler disas(*process_);
+    auto instructions = disas.disassemble_range(low, high);
+
+    auto current = std::find_if(instructions.begin(), instructions.end(),
+        [&](auto& instr) { return instr.address == pc; });
+    if (current == instructions.end()) {
+        return process_->step_instruction(tid);
+    }
+
+    using kind = disassembler::branch_kind;
+    if (current->branch == kind::call and step_over_calls) {
+        return run_until_address(pc + current->length, tid);
+    }
+    if (current->branch != kind::none) {
+        return process_->step_instruction(tid);
+    }
+
+    std::vector<virt_addr> stops{ high };
+    for (auto& instr : instructions) {
+        if (instr.branch == kind::none) continue;
+
+        bool is_jump = instr.branch == kind::jump or
+            instr.branch == kind::conditional_jump;
+        if (is_jump and instr.target) {
+            // jumps within the range don't need to stop
+            if (low <= *instr.target and *instr.target < high) continue;
+            stops.push_back(*instr.target);
+        }
+        else {
+            stops.push_back(instr.address);
+        }
+    }
+    return run_until_any_address(stops, tid);
+}
+
 
 sdb::stop_reason sdb::target::step_over(std::optional<pid_t> otid) {
     auto tid = otid.value_or(process_->current_thread());
     auto& thread = threads_.at(tid);
     auto& stack = get_stack(tid);
     auto orig_line = line_entry_at_pc(tid);
-    disassembler disas(*process_);
     sdb::stop_reason reason;
 
     do {
@@ -185,23 +336,14 @@ sdb::stop_reason sdb::target::step_over(std::optional<pid_t> otid) {
                 return reason;
             }
         }
-        else if (auto instructions = disas.disassemble(2, process_->get_pc(tid));
-            instructions[0].text.rfind("call") == 0) {
-            reason = run_until_address(instructions[1].address, tid);
-            if (!reason.is_step()
-                or process_->get_pc(tid) != instructions[1].address) {
-                thread.state->reason = reason;
-                return reason;
-            }
-        }
         else {
-            reason = process_->step_instruction(tid);
+            reason = step_line_range(tid, true);
             if (!reason.is_step()){
                 thread.state->reason = reason;
                 return reason;
             }
         }
-    } while ((line_entry_at_pc() == orig_line
+    } while ((same_line(line_entry_at_pc(), orig_line)
         or line_entry_at_pc()->end_sequence)
         and line_entry_at_pc() != line_table::iterator{});
 
@@ -222,8 +364,8 @@ sdb::stop_reason sdb::target::step_out(std::optional<pid_t> otid) {
         return run_until_address(return_address, tid);
     }
 
-    auto& regs = stack.frames()[stack.current_frame_index() + 1].regs;
-    virt_addr return_address{ regs.read_by_id_as<std::uint64_t>(register_id::rip) };
+    auto return_address = stack.frames(stack.current_frame_index() + 2)
+        [stack.current_frame_index() + 1].pc;
 
     sdb::stop_reason reason;
     for (auto frames = stack.frames().size();
@@ -290,6 +432,8 @@ sdb::target::create_line_breakpoint(
 std::string sdb::target::function_name_at_address(virt_addr address) const {
     auto file_address = address.to_file_addr(elves_);
     auto obj = file_address.elf_file();
+    if (!obj) return "";
+
     auto func = obj->get_dwarf().function_containing_address(file_address);
     auto elf_filename = obj->path().filename().string();
     std::string func_name = "";
@@ -308,6 +452,30 @@ std::string sdb::target::function_name_at_address(virt_addr address) const {
     return "";
 }
 
+std::vector<sdb::target::thread_backtrace>
+sdb::target::backtrace_all_threads() const {
+    std::vector<thread_backtrace> ret;
+    for (auto& [tid, thread] : threads_) {
+        if (thread.state->state == process_state::stopped) {
+            ret.push_back({ tid, {}, {} });
+        }
+    }
+    std::sort(ret.begin(), ret.end(),
+        [](auto& lhs, auto& rhs) { return lhs.tid < rhs.tid; });
+
+    // every stack belongs to one worker, everything they share is safe
+    // for concurrent readers
+    parallel_for(ret.size(), [&](std::size_t i) {
+        auto& trace = ret[i];
+        trace.frames = threads_.at(trace.tid).frames.frames();
+        for (auto& frame : trace.frames) {
+            trace.function_names.push_back(
+                function_name_at_address(frame.backtrace_report_address));
+        }
+    });
+    return ret;
+}
+
 void sdb::target::resolve_dynamic_linker_rendezvous() {
     if (dynamic_linker_rendezvous_address_.addr()) return;
 
@@ -344,10 +512,8 @@ std::vector<sdb::line_table::iterator> sdb::target::get_line_entries_by_line(
     std::filesystem::path path, std::size_t line) const {
     std::vector<sdb::line_table::iterator> entries;
     elves_.for_each([&](auto& elf) {
-        for (auto& cu : elf.get_dwarf().compile_units()) {
-            auto new_entries = cu->lines().get_entries_by_line(path, line);
-            entries.insert(entries.end(), new_entries.begin(), new_entries.end());
-        }
+        auto new_entries = elf.get_dwarf().line_entries_by_line(path, line);
+        entries.insert(entries.end(), new_entries.begin(), new_entries.end());
         });
     return entries;
 }
@@ -365,6 +531,12 @@ void sdb::target::reload_dynamic_libraries() {
     auto debug = read_dynamic_linker_rendezvous();
     if (!debug) return;
 
+    // pcs may resolve to newly loaded objects now
+    {
+        std::lock_guard lock(location_cache_mutex_);
+        location_cache_.clear();
+    }
+
     auto entry_ptr = debug->r_map;
     while (entry_ptr != nullptr) {
         auto entry_addr = virt_addr(
@@ -390,7 +562,7 @@ void sdb::target::reload_dynamic_libraries() {
                 name = dump_vdso(*process_, virt_addr{ entry.l_addr });
 
             }
-            auto new_elf = std::make_unique<elf>(name);
+            auto new_elf = std::make_unique<elf>(name, elf_options_);
             new_elf->notify_loaded(virt_addr{ entry.l_addr });
             elves_.push(std::move(new_elf));
         }
@@ -21,5 +21,6 @@ sdb::file_addr sdb::virt_addr::to_file_addr(const elf_collection& elves) const {
     auto obj = elves.get_elf_containing_address(*this);
     if (!obj) return file_addr{};
 
-    return to_file_addr(*obj);
+    // the collection only knows addresses inside loaded sections
+    return file_addr{ *obj, addr_ - obj->load_bias().addr() };
 }
\ No newline at end of file
@@ -0,0 +1,20 @@
+.global main
+
+.section .text
+
+# a size 0 label at the start of main, which as a local symbol comes
+# before main in the symbol table
+.type main_entry, @function
+main_entry:
+.type main, @function
+main:
+    push    %rbp
+    movq    %rsp, %rbp
+    nop
+    nop
+    nop
+    nop
+    movq    $0, %rax
+    popq    %rbp
+    ret
+.size main, .-main
@@ -0,0 +1,13 @@
+void bottom() {}
+
+int recurse(int depth) {
+    if (depth == 0) {
+        bottom();
+        return 0;
+    }
+    return recurse(depth - 1) + 1;
+}
+
+int main() {
+    return recurse(10000) != 10000;
+}
@@ -0,0 +1,7 @@
+#include <cstdio>
+
+int main() {
+	volatile long sum = 0;
+	for (long i = 0; i < 1000000; ++i) sum += i;
+	std::printf("%ld\n", sum);
+}
\ No newline at end of file
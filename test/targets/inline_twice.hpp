@@ -0,0 +1,4 @@
+inline int twice(int x) {
+    volatile int result = x * 2;
+    return result;
+}
@@ -0,0 +1,5 @@
+#include "inline_twice.hpp"
+
+int add_twice(int x) {
+    return x + twice(x);
+}
@@ -0,0 +1,7 @@
+#include "inline_twice.hpp"
+
+int add_twice(int x);
+
+int main(int argc, char**) {
+    return twice(argc) + add_twice(argc);
+}
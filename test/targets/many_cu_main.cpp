@@ -0,0 +1,5 @@
+int many_cu_function_1(int x);
+
+int main() {
+    return many_cu_function_1(0);
+}
@@ -0,0 +1,20 @@
+#include <cstddef>
+#include <utility>
+
+// thousands of C++ functions with long mangled names, for symbol table
+// benchmarks
+namespace many_symbols {
+	template <std::size_t N>
+	std::size_t symbol(std::size_t x) { return x + N; }
+
+	template <std::size_t... Ns>
+	auto table(std::index_sequence<Ns...>) {
+		static std::size_t (*functions[])(std::size_t) = { &symbol<Ns>... };
+		return functions;
+	}
+}
+
+int main(int argc, char**) {
+	auto functions = many_symbols::table(std::make_index_sequence<20000>{});
+	return functions[argc](0) == 0;
+}
\ No newline at end of file
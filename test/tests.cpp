@@ -1,4 +1,5 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <libsdb/process.hpp>
 #include <libsdb/error.hpp>
 #include <libsdb/syscalls.hpp>
@@ -14,8 +15,10 @@
 #include <fstream>
 #include <libsdb/dwarf.hpp>
 #include <libsdb/target.hpp>
+#include <libsdb/memory_snapshot.hpp>
 #include <iostream>
 #include <set>
+#include <limits>
 
 using namespace sdb;
 
@@ -541,6 +544,173 @@ TEST_CASE("ELF Parser works", "[elf]") {
     REQUIRE(name == "_start");
 }
 
+TEST_CASE("Demangled symbol lookup", "[elf]") {
+    sdb::elf elf("targets/overloaded");
+
+    auto by_mangled = elf.get_symbols_by_name("_Z10print_typei");
+    REQUIRE(by_mangled.size() == 1);
+
+    auto by_demangled = elf.get_symbols_by_name("print_type(int)");
+    REQUIRE(by_demangled.size() == 1);
+    REQUIRE(by_demangled[0] == by_mangled[0]);
+    REQUIRE(elf.get_symbols_by_name("print_type(double)").size() == 1);
+    REQUIRE(elf.get_symbols_by_name("print_type(float)").empty());
+
+    // C names aren't demangled
+    REQUIRE(elf.get_symbols_by_name("main").size() == 1);
+}
+
+TEST_CASE("Symbol address lookup", "[elf]") {
+    sdb::elf elf("targets/many_symbols");
+
+    auto symbols = elf.get_symbols_by_name("main");
+    REQUIRE(symbols.size() == 1);
+    auto main = symbols[0];
+    auto start = file_addr{ elf, main->st_value };
+    REQUIRE(elf.get_symbol_at_address(start) == main);
+    REQUIRE(elf.get_symbol_containing_address(start + main->st_size / 2) == main);
+    REQUIRE(!elf.get_symbol_at_address(start + 1));
+
+    for (auto index : { 0, 1, 19999 }) {
+        auto name = "unsigned long many_symbols::symbol<" +
+            std::to_string(index) + "ul>(unsigned long)";
+        auto found = elf.get_symbols_by_name(name);
+        REQUIRE(found.size() == 1);
+
+        auto address = file_addr{ elf, found[0]->st_value + 1 };
+        auto containing = elf.get_symbol_containing_address(address);
+        REQUIRE(containing);
+        REQUIRE(containing.value()->st_value == found[0]->st_value);
+    }
+
+    REQUIRE(!elf.get_symbol_containing_address(file_addr{ elf, 0 }));
+}
+
+TEST_CASE("Symbol address lookup with aliases", "[elf]") {
+    sdb::elf elf("targets/aliased");
+
+    // main_entry is a size 0 alias of main that comes first in the table
+    auto main = elf.get_symbols_by_name("main").at(0);
+    auto entry = elf.get_symbols_by_name("main_entry").at(0);
+    REQUIRE(entry < main);
+    REQUIRE(entry->st_value == main->st_value);
+    REQUIRE(entry->st_size == 0);
+
+    auto start = file_addr{ elf, main->st_value };
+    REQUIRE(elf.get_symbol_at_address(start) == main);
+    for (std::uint64_t offset = 1; offset < main->st_size; ++offset) {
+        REQUIRE(elf.get_symbol_containing_address(start + offset) == main);
+    }
+    REQUIRE(elf.get_symbol_containing_address(start + main->st_size) != main);
+}
+
+TEST_CASE("Dynamic symbol hash tables", "[elf]") {
+    for (auto path : { "targets/libmeow_gnu_hash.so", "targets/libmeow_sysv_hash.so" }) {
+        sdb::elf elf(path);
+        REQUIRE(!elf.get_section(".symtab"));
+
+        auto symbols = elf.get_symbols_by_name("_Z22libmeow_client_is_cutev");
+        REQUIRE(symbols.size() == 1);
+        REQUIRE(elf.get_symbol_at_address(file_addr{ elf, symbols[0]->st_value }) == symbols[0]);
+        REQUIRE(elf.get_symbols_by_name("libmeow_client_is_cute()") == symbols);
+
+        // defined elsewhere
+        REQUIRE(elf.get_symbols_by_name("libmeow_client_cuteness").empty());
+        REQUIRE(elf.get_symbols_by_name("libmeow_client_is_not_cute").empty());
+    }
+}
+
+TEST_CASE("Corrupt dynamic symbol hash tables", "[elf]") {
+    auto directory = std::filesystem::temp_directory_path() /
+        ("sdb-hash-tables-" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    // buckets past the end of .dynsym in one, a chain count too big for
+    // the section in the other. lookups fall back to the name index
+    for (std::string style : { "gnu", "sysv" }) {
+        auto original = "targets/libmeow_" + style + "_hash.so";
+        std::ifstream in(original, std::ios::binary);
+        std::string contents(std::istreambuf_iterator<char>(in), {});
+
+        auto table = sdb::elf(original).get_section(
+            style == "gnu" ? ".gnu.hash" : ".hash").value()->sh_offset;
+        auto word = [&](std::size_t i) -> std::uint32_t& {
+            return *reinterpret_cast<std::uint32_t*>(
+                contents.data() + table + i * sizeof(std::uint32_t));
+        };
+        if (style == "gnu") {
+            auto buckets = 4 + 2 * word(2);
+            for (std::size_t i = 0; i < word(0); ++i) word(buckets + i) = 0xfffffff0;
+        }
+        else {
+            word(1) = 0xffffffff;
+        }
+
+        auto path = directory / ("libmeow_" + style + "_hash.so");
+        std::ofstream(path, std::ios::binary) << contents;
+
+        sdb::elf elf(path);
+        auto symbols = elf.get_symbols_by_name("_Z22libmeow_client_is_cutev");
+        REQUIRE(symbols.size() == 1);
+        REQUIRE(elf.get_string(symbols[0]->st_name) == "_Z22libmeow_client_is_cutev");
+        REQUIRE(elf.get_symbols_by_name("libmeow_client_is_not_cute").empty());
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Symbol lookup benchmark", "[elf][.][benchmark]") {
+    sdb::elf elf("targets/many_symbols");
+    auto text = elf.get_section(".text").value();
+    auto address = file_addr{ elf, text->sh_addr + text->sh_size / 2 };
+    BENCHMARK("symbol containing address") {
+        return elf.get_symbol_containing_address(address);
+    };
+    BENCHMARK("symbols by name") {
+        return elf.get_symbols_by_name("main").size();
+    };
+}
+
+TEST_CASE("ELF loading benchmark", "[elf][.][benchmark]") {
+    auto path = "targets/many_symbols";
+    BENCHMARK("load " + std::string(path)) {
+        return sdb::elf(path).get_header().e_entry;
+    };
+    BENCHMARK("load and look up a demangled name " + std::string(path)) {
+        sdb::elf elf(path);
+        return elf.get_symbols_by_name(
+            "unsigned long many_symbols::symbol<42ul>(unsigned long)").size();
+    };
+}
+
+TEST_CASE("ELF address index", "[elf]") {
+    elf_collection elves;
+    auto obj = std::make_unique<sdb::elf>("targets/hello_sdb");
+    auto& elf = *obj;
+    elf.notify_loaded(virt_addr{ 0x10000 });
+    elves.push(std::move(obj));
+
+    auto text = elf.get_section(".text").value();
+    auto address = virt_addr{ 0x10000 + text->sh_addr };
+    REQUIRE(elves.get_elf_containing_address(address) == &elf);
+    REQUIRE(elf.get_section_containing_address(address) == text);
+    REQUIRE(address.to_file_addr(elves).addr() == text->sh_addr);
+
+    auto past_end = address + text->sh_size + 0x100000;
+    REQUIRE(elves.get_elf_containing_address(past_end) == nullptr);
+
+    // sections that aren't loaded have no address
+    auto comment = elf.get_section(".comment").value();
+    REQUIRE(elf.get_section_containing_address(
+        file_addr{ elf, comment->sh_addr }) == nullptr);
+
+    elves.notify_loaded(elf, virt_addr{ 0x200000 });
+    REQUIRE(elves.get_elf_containing_address(address) == nullptr);
+    REQUIRE(elves.get_elf_containing_address(
+        virt_addr{ 0x200000 + text->sh_addr }) == &elf);
+}
+
 TEST_CASE("Correct DWARF language", "[dwarf]") {
     auto path = "targets/hello_sdb";
     sdb::elf elf(path);
@@ -668,6 +838,596 @@ TEST_CASE("Line table", "[dwarf]") {
     REQUIRE(it == cu->lines().end());
 }
 
+TEST_CASE("Line table lookup by address", "[dwarf]") {
+    auto path = "targets/step";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    for (auto& cu : dwarf.compile_units()) {
+        auto& lines = cu->lines();
+        for (auto it = lines.begin(); it != lines.end(); ++it) {
+            auto next = std::next(it);
+            if (it->end_sequence or it->address == next->address) continue;
+
+            REQUIRE(lines.get_entry_by_address(it->address) == it);
+            REQUIRE(lines.get_entry_by_address(next->address - 1) == it);
+        }
+    }
+
+    REQUIRE(dwarf.line_entry_at_address(file_addr{ elf, 0 }) ==
+        sdb::line_table::iterator{});
+}
+
+TEST_CASE("Line table lookup benchmark", "[dwarf][.][benchmark]") {
+    auto path = "targets/step";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    auto main = dwarf.find_functions("main");
+    auto address = main[0].high_pc() - 1;
+    BENCHMARK("line_entry_at_address") {
+        return dwarf.line_entry_at_address(address);
+    };
+}
+
+TEST_CASE("Line entries by file and line", "[dwarf]") {
+    auto path = "targets/multi_cu";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    auto main_path = dwarf.find_functions("main")[0].file().path;
+    for (std::filesystem::path file : {
+        main_path, std::filesystem::path("multi_cu_main.cpp"),
+        std::filesystem::path("multi_cu_do_something.cpp"),
+        std::filesystem::path("no_such_file.cpp") }) {
+        for (std::size_t line = 0; line < 20; ++line) {
+            std::vector<sdb::line_table::iterator> expected;
+            for (auto& cu : dwarf.compile_units()) {
+                auto entries = cu->lines().get_entries_by_line(file, line);
+                expected.insert(expected.end(), entries.begin(), entries.end());
+            }
+            REQUIRE(dwarf.line_entries_by_line(file, line) == expected);
+        }
+    }
+
+    REQUIRE(!dwarf.line_entries_by_line("multi_cu_main.cpp", 3).empty());
+}
+
+TEST_CASE("Compile unit lookup by address", "[dwarf]") {
+    auto path = "targets/multi_cu";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    REQUIRE(dwarf.compile_units().size() == 2);
+    for (auto& cu : dwarf.compile_units()) {
+        auto root = cu->root();
+        REQUIRE(dwarf.compile_unit_containing_address(root.low_pc()) == cu.get());
+        REQUIRE(dwarf.compile_unit_containing_address(root.high_pc() - 1) == cu.get());
+        REQUIRE(dwarf.compile_unit_containing_address(root.high_pc()) != cu.get());
+    }
+
+    REQUIRE(dwarf.compile_unit_containing_address(file_addr{ elf, 0 }) == nullptr);
+}
+
+TEST_CASE("Compile unit lookup scales with CU count", "[dwarf][.][benchmark]") {
+    for (auto path : { "targets/hello_sdb", "targets/multi_cu", "targets/many_cu" }) {
+        sdb::elf elf(path);
+        auto& dwarf = elf.get_dwarf();
+        auto& compile_units = dwarf.compile_units();
+
+        // the last compile unit is the worst case for a linear scan
+        auto address = compile_units.back()->root().low_pc();
+        BENCHMARK(std::to_string(compile_units.size()) + " compile units") {
+            return dwarf.compile_unit_containing_address(address);
+        };
+    }
+}
+
+TEST_CASE("Function lookup by address", "[dwarf]") {
+    auto path = "targets/step";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    auto functions = dwarf.find_functions("scratch_ears");
+    REQUIRE(!functions.empty());
+    for (auto& func : functions) {
+        auto containing = dwarf.function_containing_address(func.low_pc());
+        REQUIRE(containing.has_value());
+        REQUIRE(containing->abbrev_entry()->tag == DW_TAG_subprogram);
+        REQUIRE(containing->contains_address(func.low_pc()));
+
+        // inlined copies resolve to the function they were inlined into
+        if (func.abbrev_entry()->tag == DW_TAG_inlined_subroutine) {
+            REQUIRE(containing->name() != "scratch_ears");
+        }
+        else {
+            REQUIRE(containing->position() == func.position());
+        }
+    }
+
+    auto main = dwarf.find_functions("main");
+    REQUIRE(main.size() == 1);
+    auto containing = dwarf.function_containing_address(main[0].high_pc());
+    REQUIRE((!containing or containing->name() != "main"));
+}
+
+TEST_CASE("Inline stacks", "[dwarf]") {
+    auto path = "targets/step";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+
+    // line 5 is the body of scratch_ears. it's inlined into pet_cat, and
+    // both are inlined into find_happiness, besides their own copies
+    std::size_t inlined = 0;
+    for (auto& cu : dwarf.compile_units()) {
+        for (auto& entry : cu->lines()) {
+            if (entry.end_sequence or entry.line != 5 or
+                entry.file_entry->path.filename() != "step.cpp") continue;
+
+            auto stack = dwarf.inline_stack_at_address(entry.address);
+            REQUIRE(stack.back().name() == "scratch_ears");
+            REQUIRE(stack.size() <= 3);
+            if (stack.size() < 3) continue;
+
+            REQUIRE(stack[0].name() == "find_happiness");
+            REQUIRE(stack[1].name() == "pet_cat");
+            ++inlined;
+        }
+    }
+    REQUIRE(inlined > 0);
+
+    auto main = dwarf.find_functions("main");
+    REQUIRE(main.size() == 1);
+    auto stack = dwarf.inline_stack_at_address(main[0].low_pc());
+    REQUIRE(stack.size() == 1);
+    REQUIRE(stack[0].position() == main[0].position());
+
+    REQUIRE(dwarf.inline_stack_at_address(file_addr{ elf, 0 }).empty());
+}
+
+TEST_CASE("Function lookup scales with function count", "[dwarf][.][benchmark]") {
+    for (auto path : { "targets/hello_sdb", "targets/many_cu" }) {
+        sdb::elf elf(path);
+        auto& dwarf = elf.get_dwarf();
+
+        auto address = dwarf.compile_units().back()->root().low_pc();
+        dwarf.function_containing_address(address);
+        BENCHMARK(std::string(path)) {
+            return dwarf.function_containing_address(address);
+        };
+    }
+}
+
+TEST_CASE("Background DWARF indexing", "[dwarf]") {
+    auto path = "targets/many_cu";
+    sdb::elf foreground(path);
+    sdb::elf background(path, { true });
+
+    for (auto name : { "main", "many_cu_function_1", "many_cu_function_256" }) {
+        auto expected = foreground.get_dwarf().find_functions(name);
+        auto found = background.get_dwarf().find_functions(name);
+        REQUIRE(found.size() == 1);
+        REQUIRE(found.size() == expected.size());
+        REQUIRE(found[0].low_pc().addr() == expected[0].low_pc().addr());
+    }
+
+    // destroying an elf while it is still being indexed must be safe
+    sdb::elf discarded(path, { true });
+}
+
+TEST_CASE("Separate debug files", "[dwarf]") {
+    auto directory = std::filesystem::temp_directory_path() /
+        ("sdb-debug-files-" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    auto require_source_info = [](const sdb::elf& elf) {
+        REQUIRE(!elf.get_section(".debug_info"));
+        auto& dwarf = elf.get_dwarf();
+        auto functions = dwarf.find_functions("find_happiness");
+        REQUIRE(functions.size() == 1);
+
+        auto address = functions[0].low_pc();
+        REQUIRE(address.elf_file() == &elf);
+        auto entry = dwarf.line_entry_at_address(address);
+        REQUIRE(entry != sdb::line_table::iterator{});
+        REQUIRE(entry->line == 14);
+    };
+
+    sdb::elf linked("targets/step_debuglink");
+    REQUIRE(std::filesystem::equivalent(
+        linked.debug_file().path(), "targets/step_debuglink.debug"));
+    require_source_info(linked);
+
+    {
+        auto dev_null = open("/dev/null", O_WRONLY);
+        auto target = target::launch("targets/step_debuglink", dev_null);
+        auto& proc = target->get_process();
+        target->create_line_breakpoint("step.cpp", 16).enable();
+
+        proc.resume();
+        proc.wait_on_signal();
+        REQUIRE(target->line_entry_at_pc()->line == 16);
+        REQUIRE(target->function_name_at_pc() == "step_debuglink`find_happiness");
+        close(dev_null);
+    }
+
+    sdb::elf unfound("targets/step_build_id");
+    REQUIRE(&unfound.debug_file() == &unfound);
+
+    std::string id;
+    for (auto byte : unfound.build_id()) {
+        id += "0123456789abcdef"[static_cast<std::uint8_t>(byte) >> 4];
+        id += "0123456789abcdef"[static_cast<std::uint8_t>(byte) & 0xf];
+    }
+    auto path = directory / ".build-id" / id.substr(0, 2) / (id.substr(2) + ".debug");
+    std::filesystem::create_directories(path.parent_path());
+    std::filesystem::copy_file("targets/step_build_id.debug", path);
+
+    sdb::elf_options options;
+    options.debug_directories = { directory };
+    sdb::elf found("targets/step_build_id", options);
+    REQUIRE(std::filesystem::equivalent(found.debug_file().path(), path));
+    require_source_info(found);
+
+    // a debug link to the wrong file is ignored
+    std::filesystem::copy_file("targets/step_debuglink", directory / "step_debuglink");
+    std::filesystem::copy_file("targets/step", directory / "step_debuglink.debug");
+    sdb::elf mismatched(directory / "step_debuglink");
+    REQUIRE(&mismatched.debug_file() == &mismatched);
+    REQUIRE(mismatched.get_dwarf().compile_units().empty());
+
+    // so is one whose DWARF can't be read, and the symbols still work
+    for (auto name : { "step_dwarf5_debuglink", "step_compressed_debuglink" }) {
+        auto path = std::filesystem::path("targets") / name;
+        sdb::elf unreadable(path);
+        REQUIRE(&unreadable.debug_file() == &unreadable);
+        REQUIRE(unreadable.get_dwarf().find_functions("find_happiness").empty());
+
+        auto dev_null = open("/dev/null", O_WRONLY);
+        auto target = target::launch(path, dev_null);
+        auto& proc = target->get_process();
+        target->create_function_breakpoint("main").enable();
+        proc.resume();
+        proc.wait_on_signal();
+        REQUIRE(target->function_name_at_pc() == std::string(name) + "`main");
+        REQUIRE(target->get_stack().frames().size() > 1);
+        close(dev_null);
+    }
+
+    // the debug file isn't looked for until DWARF is needed
+    std::filesystem::remove(directory / "step_debuglink.debug");
+    std::filesystem::copy_file(
+        "targets/step_debuglink.debug", directory / "step_debuglink.debug");
+    sdb::elf deferred(directory / "step_debuglink");
+    std::filesystem::remove(directory / "step_debuglink.debug");
+    REQUIRE(&deferred.debug_file() == &deferred);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("DWARF index cache", "[dwarf]") {
+    auto path = "targets/multi_cu";
+    auto directory = std::filesystem::temp_directory_path() /
+        ("sdb-index-cache-" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+
+    sdb::elf_options options;
+    options.index_cache_directory = directory;
+
+    auto cache_contents = [&] {
+        std::vector<std::filesystem::path> files(
+            std::filesystem::directory_iterator(directory), {});
+        REQUIRE(files.size() == 1);
+        std::ifstream in(files[0], std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), {});
+    };
+
+    auto require_same_as_uncached = [&](const sdb::elf& cached) {
+        sdb::elf uncached(path);
+        auto& expected = uncached.get_dwarf();
+        auto& found = cached.get_dwarf();
+
+        for (auto name : { "main", "do_something", "nope" }) {
+            auto expected_dies = expected.find_functions(name);
+            auto found_dies = found.find_functions(name);
+            REQUIRE(found_dies.size() == expected_dies.size());
+            for (std::size_t i = 0; i < found_dies.size(); ++i) {
+                REQUIRE(found_dies[i].position() - found.debug_info().begin() ==
+                    expected_dies[i].position() - expected.debug_info().begin());
+            }
+        }
+
+        for (std::size_t i = 0; i < expected.compile_units().size(); ++i) {
+            auto& expected_lines = expected.compile_units()[i]->lines();
+            auto& found_lines = found.compile_units()[i]->lines();
+            auto same_row = [](auto& lhs, auto& rhs) {
+                return lhs.address.addr() == rhs.address.addr() and
+                    lhs.line == rhs.line and lhs.column == rhs.column and
+                    lhs.file_entry->path == rhs.file_entry->path and
+                    lhs.end_sequence == rhs.end_sequence;
+            };
+            REQUIRE(std::equal(found_lines.begin(), found_lines.end(),
+                expected_lines.begin(), expected_lines.end(), same_row));
+
+            for (auto& entry : expected_lines) {
+                auto addr = entry.address.addr();
+                auto expected_cu = expected.compile_unit_containing_address(
+                    file_addr{ uncached, addr });
+                auto found_cu = found.compile_unit_containing_address(
+                    file_addr{ cached, addr });
+                REQUIRE((found_cu == nullptr) == (expected_cu == nullptr));
+
+                auto expected_function = expected.function_containing_address(
+                    file_addr{ uncached, addr });
+                auto found_function = found.function_containing_address(
+                    file_addr{ cached, addr });
+                REQUIRE(found_function.has_value() == expected_function.has_value());
+                if (found_function) {
+                    REQUIRE(found_function->name() == expected_function->name());
+                }
+            }
+        }
+    };
+
+    // nothing is read or written until the first lookup
+    sdb::elf writer(path, options);
+    REQUIRE(!std::filesystem::exists(directory));
+    writer.get_dwarf().find_functions("main");
+    REQUIRE(!writer.get_dwarf().index_cache_loaded());
+    auto written = cache_contents();
+    REQUIRE(!written.empty());
+
+    sdb::elf reader(path, options);
+    REQUIRE(!reader.get_dwarf().index_cache_loaded());
+    require_same_as_uncached(reader);
+    REQUIRE(reader.get_dwarf().index_cache_loaded());
+    REQUIRE(cache_contents() == written);
+
+    // a damaged cache is thrown away and rebuilt
+    for (auto& file : std::filesystem::directory_iterator(directory)) {
+        std::filesystem::resize_file(file.path(), written.size() / 2);
+    }
+    sdb::elf rebuilt(path, options);
+    require_same_as_uncached(rebuilt);
+    REQUIRE(!rebuilt.get_dwarf().index_cache_loaded());
+    REQUIRE(cache_contents() == written);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("DWARF index cache for separate debug files", "[dwarf]") {
+    auto directory = std::filesystem::temp_directory_path() /
+        ("sdb-debug-index-cache-" + std::to_string(getpid()));
+    std::filesystem::remove_all(directory);
+
+    sdb::elf_options uncached_options;
+    uncached_options.debug_directories = { directory };
+    auto options = uncached_options;
+    options.index_cache_directory = directory / "cache";
+
+    for (auto path : { "targets/step_debuglink", "targets/step_build_id" }) {
+        std::filesystem::remove_all(options.index_cache_directory);
+
+        // step_build_id's debug file is only found by build ID
+        sdb::elf uncached(path, uncached_options);
+        std::string id;
+        for (auto byte : uncached.build_id()) {
+            id += "0123456789abcdef"[static_cast<std::uint8_t>(byte) >> 4];
+            id += "0123456789abcdef"[static_cast<std::uint8_t>(byte) & 0xf];
+        }
+        auto debug_path = directory / ".build-id" / id.substr(0, 2) / (id.substr(2) + ".debug");
+        if (!std::filesystem::exists(debug_path)) {
+            std::filesystem::create_directories(debug_path.parent_path());
+            std::filesystem::copy_file("targets/step_build_id.debug", debug_path);
+        }
+
+        auto expected = uncached.get_dwarf().find_functions("find_happiness");
+        REQUIRE(&uncached.debug_file() != &uncached);
+        REQUIRE(expected.size() == 1);
+
+        // the cache is keyed on the debug file, whose names it points into
+        sdb::elf writer(path, options);
+        writer.get_dwarf().find_functions("find_happiness");
+        REQUIRE(!writer.get_dwarf().index_cache_loaded());
+        REQUIRE(std::filesystem::exists(options.index_cache_directory / (id + ".sdbidx")));
+
+        sdb::elf reader(path, options);
+        auto& dwarf = reader.get_dwarf();
+        auto found = dwarf.find_functions("find_happiness");
+        REQUIRE(dwarf.index_cache_loaded());
+        REQUIRE(found.size() == 1);
+        REQUIRE(found[0].position() - dwarf.debug_info().begin() ==
+            expected[0].position() - uncached.get_dwarf().debug_info().begin());
+
+        auto address = found[0].low_pc();
+        REQUIRE(dwarf.function_containing_address(address)->name() == "find_happiness");
+        REQUIRE(dwarf.line_entry_at_address(address)->line == 14);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Function lookup through .gdb_index", "[dwarf]") {
+#ifndef SDB_HAVE_GOLD
+    SKIP("step_gdb_index needs a linker with --gdb-index support");
+#endif
+    auto path = "targets/step_gdb_index";
+
+    sdb::elf indexed(path);
+    sdb::elf walked(path);
+    REQUIRE(indexed.get_dwarf().has_name_index());
+
+    // building the address index forces the full DIE walk
+    walked.get_dwarf().function_containing_address(file_addr{ walked, 0 });
+
+    for (auto name : { "main", "find_happiness", "pet_cat", "scratch_ears", "nope" }) {
+        auto found = indexed.get_dwarf().find_functions(name);
+        auto expected = walked.get_dwarf().find_functions(name);
+
+        auto low_pcs = [](auto& dies) {
+            std::multiset<std::uint64_t> pcs;
+            for (auto& die : dies) pcs.insert(die.low_pc().addr());
+            return pcs;
+        };
+        REQUIRE(low_pcs(found) == low_pcs(expected));
+    }
+
+    auto units = indexed.get_dwarf().compile_units_with_name("main");
+    REQUIRE(units.size() == 1);
+    REQUIRE(units[0] == indexed.get_dwarf().compile_units()[0].get());
+
+    // the out of line copy and the one inlined into add_twice
+    sdb::elf inlined("targets/inline_twice");
+    auto copies = inlined.get_dwarf().find_functions("twice");
+    REQUIRE(copies.size() == 2);
+    REQUIRE(std::count_if(copies.begin(), copies.end(), [](auto& die) {
+        return die.abbrev_entry()->tag == DW_TAG_inlined_subroutine;
+    }) == 1);
+}
+
+TEST_CASE("Function indexing benchmark", "[dwarf][.][benchmark]") {
+    for (auto path : { "targets/step", "targets/many_cu", "targets/libmeow.so" }) {
+        sdb::elf elf(path);
+        BENCHMARK("index " + std::string(path)) {
+            sdb::dwarf dwarf(elf);
+            return dwarf.find_functions("main").size();
+        };
+    }
+}
+
+TEST_CASE("LEB128 decoding", "[dwarf]") {
+    auto encode_uleb128 = [](std::uint64_t value) {
+        std::vector<std::byte> ret;
+        do {
+            auto byte = value & 0x7f;
+            value >>= 7;
+            if (value != 0) byte |= 0x80;
+            ret.push_back(std::byte(byte));
+        } while (value != 0);
+        return ret;
+    };
+    auto encode_sleb128 = [](std::int64_t value) {
+        std::vector<std::byte> ret;
+        while (true) {
+            auto byte = value & 0x7f;
+            value >>= 7;
+            bool done = (value == 0 and !(byte & 0x40)) or
+                (value == -1 and (byte & 0x40));
+            if (!done) byte |= 0x80;
+            ret.push_back(std::byte(byte));
+            if (done) return ret;
+        }
+    };
+
+    // values with 8 readable bytes from their start take the fast path,
+    // ones at the very end of the data the byte-wise one
+    auto decode = [](const std::vector<std::byte>& encoded, auto decoder) {
+        auto padded = encoded;
+        padded.resize(encoded.size() + 8, std::byte{ 0xff });
+        auto pos = static_cast<const std::byte*>(padded.data());
+        auto fast = decoder(pos, padded.data() + padded.size());
+        REQUIRE(pos == padded.data() + encoded.size());
+
+        pos = encoded.data();
+        auto slow = decoder(pos, encoded.data() + encoded.size());
+        REQUIRE(pos == encoded.data() + encoded.size());
+        REQUIRE(fast == slow);
+        return fast;
+    };
+    auto uleb128 = [](auto& pos, auto end) { return decode_uleb128(pos, end); };
+    auto sleb128 = [](auto& pos, auto end) { return decode_sleb128(pos, end); };
+    auto bytes = [](std::initializer_list<int> values) {
+        std::vector<std::byte> ret;
+        for (auto value : values) ret.push_back(std::byte(value));
+        return ret;
+    };
+
+    // examples from the DWARF 4 standard, section 7.6
+    REQUIRE(decode(bytes({ 0x02 }), uleb128) == 2);
+    REQUIRE(decode(bytes({ 0x7f }), uleb128) == 127);
+    REQUIRE(decode(bytes({ 0x80, 0x01 }), uleb128) == 128);
+    REQUIRE(decode(bytes({ 0x81, 0x01 }), uleb128) == 129);
+    REQUIRE(decode(bytes({ 0xb9, 0x64 }), uleb128) == 12857);
+    REQUIRE(decode(bytes({ 0x7e }), sleb128) == -2);
+    REQUIRE(decode(bytes({ 0xff, 0x00 }), sleb128) == 127);
+    REQUIRE(decode(bytes({ 0x81, 0x7f }), sleb128) == -127);
+    REQUIRE(decode(bytes({ 0x80, 0x7f }), sleb128) == -128);
+    REQUIRE(decode(bytes({ 0xff, 0x7e }), sleb128) == -129);
+
+    // padding bytes are allowed
+    REQUIRE(decode(bytes({ 0x80, 0x80, 0x00 }), uleb128) == 0);
+    REQUIRE(decode(bytes({ 0xff, 0xff, 0x7f }), sleb128) == -1);
+
+    // around the widths where the fast path gives up, 8 bytes holding
+    // 56 bits, up to the 10 bytes of a full 64 bit value
+    std::vector<std::uint64_t> unsigned_values;
+    for (auto bits : { 7, 14, 35, 49, 56, 63, 64 }) {
+        auto max = bits == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+        unsigned_values.push_back(max);
+        if (bits < 64) unsigned_values.push_back(max + 1);
+    }
+    for (auto value : unsigned_values) {
+        REQUIRE(decode(encode_uleb128(value), uleb128) == value);
+    }
+    REQUIRE(encode_uleb128(~std::uint64_t(0)).size() == 10);
+
+    std::vector<std::int64_t> signed_values{
+        std::numeric_limits<std::int64_t>::min(),
+        std::numeric_limits<std::int64_t>::max() };
+    for (auto bits : { 6, 13, 34, 48, 55, 62 }) {
+        auto max = (std::int64_t(1) << bits) - 1;
+        for (auto value : { max, max + 1, -max - 1, -max - 2 }) {
+            signed_values.push_back(value);
+        }
+    }
+    for (auto value : signed_values) {
+        REQUIRE(decode(encode_sleb128(value), sleb128) == value);
+    }
+    REQUIRE(encode_sleb128(std::numeric_limits<std::int64_t>::min()).size() == 10);
+
+    // a run of values decoded in place, the last ones with fewer than 8
+    // bytes left after them
+    std::vector<std::byte> packed;
+    for (auto value : unsigned_values) {
+        auto encoded = encode_uleb128(value);
+        packed.insert(packed.end(), encoded.begin(), encoded.end());
+    }
+    auto pos = static_cast<const std::byte*>(packed.data());
+    for (auto value : unsigned_values) {
+        REQUIRE(decode_uleb128(pos, packed.data() + packed.size()) == value);
+    }
+    REQUIRE(pos == packed.data() + packed.size());
+}
+
+TEST_CASE("DWARF decoding benchmark", "[dwarf][.][benchmark]") {
+    for (auto path : { "targets/step", "targets/many_cu", "targets/libmeow.so" }) {
+        sdb::elf elf(path);
+
+        // units and abbreviations are parsed once, so this times DIE decoding
+        auto& parsed = elf.get_dwarf();
+        BENCHMARK("walk .debug_info " + std::string(path)) {
+            std::size_t count = 0;
+            auto walk = [&](auto& self, const sdb::die& die) -> void {
+                ++count;
+                for (auto& child : die.children()) self(self, child);
+            };
+            for (auto& cu : parsed.compile_units()) walk(walk, cu->root());
+            return count;
+        };
+
+        BENCHMARK("decode .debug_line " + std::string(path)) {
+            std::size_t count = 0;
+            sdb::dwarf dwarf(elf);
+            for (auto& cu : dwarf.compile_units()) {
+                auto& lines = cu->lines();
+                count += std::distance(lines.begin(), lines.end());
+            }
+            return count;
+        };
+    }
+}
+
 TEST_CASE("Source-level breakpoints", "[breakpoint]") {
     auto dev_null = open("/dev/null", O_WRONLY);
     auto target = target::launch("targets/overloaded", dev_null);
@@ -753,6 +1513,65 @@ TEST_CASE("Source-level stepping", "[target]") {
 }
 
 
+TEST_CASE("Range stepping", "[target]") {
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/hot_loop", dev_null);
+    auto& proc = target->get_process();
+
+    auto& bp = target->create_line_breakpoint("hot_loop.cpp", 5);
+    bp.enable();
+    proc.resume();
+    proc.wait_on_signal();
+    REQUIRE(target->line_entry_at_pc()->line == 5);
+    bp.disable();
+
+    // a million iterations, which would take millions of single steps.
+    // every stop bumps the stop epoch
+    auto epoch = target->stop_epoch();
+    auto reason = target->step_over();
+    REQUIRE(reason.is_step());
+    REQUIRE(target->line_entry_at_pc()->line == 6);
+    REQUIRE(target->stop_epoch() - epoch < 10);
+
+    // and over the call to printf
+    reason = target->step_over();
+    REQUIRE(reason.is_step());
+    REQUIRE(target->line_entry_at_pc()->line == 7);
+    close(dev_null);
+}
+
+TEST_CASE("Stepping onto a disabled breakpoint", "[target]") {
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/hot_loop", dev_null);
+    auto& proc = target->get_process();
+
+    auto& bp = target->create_line_breakpoint("hot_loop.cpp", 5);
+    bp.enable();
+    proc.resume();
+    proc.wait_on_signal();
+    REQUIRE(target->line_entry_at_pc()->line == 5);
+    bp.disable();
+
+    // the next line's only site belongs to a disabled breakpoint, so
+    // the step still has to stop there without running its handler
+    bool hit = false;
+    auto& next = target->create_line_breakpoint("hot_loop.cpp", 6);
+    next.install_hit_handler([&] { hit = true; return false; });
+    next.enable();
+    next.disable();
+
+    auto reason = target->step_over();
+    REQUIRE(reason.is_step());
+    REQUIRE(target->line_entry_at_pc()->line == 6);
+    REQUIRE(!hit);
+
+    // and the site is left as it was found
+    next.breakpoint_sites().for_each([](auto& site) {
+        REQUIRE(!site.is_enabled());
+    });
+    close(dev_null);
+}
+
 TEST_CASE("Stack unwinding", "[unwind]") {
     auto target = target::launch("targets/step");
     auto& proc = target->get_process();
@@ -772,9 +1591,314 @@ TEST_CASE("Stack unwinding", "[unwind]") {
 
     auto frames = target->get_stack().frames();
 
-    for (auto i = 0; i < frames.size(); ++i) {
+    // libc's frames follow, named from its symbols alone
+    REQUIRE(frames.size() > expected_names.size());
+    for (auto i = 0; i < expected_names.size(); ++i) {
         REQUIRE(frames[i].func_die.name().value() == expected_names[i]);
     }
+    for (auto i = expected_names.size(); i < frames.size(); ++i) {
+        REQUIRE(!frames[i].location.file);
+    }
+    auto outermost = frames[frames.size() - 1].backtrace_report_address;
+    REQUIRE(target->function_name_at_address(outermost) == "step`_start");
+}
+
+TEST_CASE("Unwind plans", "[unwind]") {
+    using kind = call_frame_information::register_rule::kind;
+    auto path = "targets/step";
+    sdb::elf elf(path);
+    auto& dwarf = elf.get_dwarf();
+    auto main = dwarf.find_functions("main")[0];
+
+    auto& plan = dwarf.cfi().plan_at(main.low_pc());
+    REQUIRE(&plan == &dwarf.cfi().plan_at(main.high_pc() - 1));
+    REQUIRE(plan.low == main.low_pc().addr());
+    REQUIRE(plan.high >= main.high_pc().addr());
+    REQUIRE(std::is_sorted(plan.rows.begin(), plan.rows.end(),
+        [](auto& lhs, auto& rhs) { return lhs.location < rhs.location; }));
+
+    // on entry the CFA is just above the return address
+    auto& entry = plan.rows.front();
+    REQUIRE(entry.location == plan.low);
+    REQUIRE(entry.cfa_register == 7);
+    REQUIRE(entry.cfa_offset == 8);
+    REQUIRE(entry.rules[16].type == kind::offset);
+    REQUIRE(entry.rules[16].value == -8);
+
+    // and after the prologue it's based on the frame pointer
+    auto body = std::find_if(plan.rows.begin(), plan.rows.end(),
+        [](auto& row) { return row.cfa_register == 6; });
+    REQUIRE(body != plan.rows.end());
+    REQUIRE(body->cfa_offset == 16);
+    REQUIRE(body->rules[6].type == kind::offset);
+    REQUIRE(body->rules[6].value == -16);
+}
+
+TEST_CASE("Unwinding without .eh_frame_hdr", "[unwind]") {
+    for (std::string name : { "step_debug_frame", "step_no_eh_frame_hdr" }) {
+        auto path = "targets/" + name;
+
+        sdb::elf elf(path);
+        auto& dwarf = elf.get_dwarf();
+        auto main = dwarf.find_functions("main")[0];
+        REQUIRE(dwarf.cfi().covers(main.low_pc()));
+        REQUIRE(dwarf.cfi().plan_at(main.high_pc() - 1).low == main.low_pc().addr());
+
+        auto target = target::launch(path);
+        auto& proc = target->get_process();
+        target->create_function_breakpoint("scratch_ears").enable();
+        proc.resume();
+        proc.wait_on_signal();
+
+        auto frames = target->get_stack().frames();
+        REQUIRE(frames.size() > 2);
+        REQUIRE(frames[1].func_die.name().value() == "main");
+        auto outermost = frames[frames.size() - 1].backtrace_report_address;
+        REQUIRE(target->function_name_at_address(outermost) == name + "`_start");
+    }
+}
+
+TEST_CASE("Stack unwinding from a memory snapshot", "[unwind]") {
+    auto target = target::launch("targets/step");
+    auto& proc = target->get_process();
+
+    target->create_function_breakpoint("scratch_ears").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto start_pc = target->get_pc_file_address();
+    auto& elf = *start_pc.elf_file();
+    auto& cfi = elf.get_dwarf().cfi();
+
+    auto unwind_all = [&](auto unwind_one) {
+        std::vector<std::uint64_t> return_addresses;
+        auto pc = start_pc;
+        auto regs = proc.get_registers();
+        while (pc.elf_file() == &elf and
+            elf.get_dwarf().function_containing_address(pc)) {
+            regs = unwind_one(pc, regs);
+            auto rip = regs.read_by_id_as<std::uint64_t>(register_id::rip);
+            return_addresses.push_back(rip);
+            pc = virt_addr{ rip - 1 }.to_file_addr(elf);
+        }
+        return return_addresses;
+    };
+
+    auto expected = unwind_all([&](auto pc, auto& regs) {
+        return cfi.unwind(proc, pc, regs);
+        });
+
+    auto rsp = proc.get_registers().read_by_id_as<std::uint64_t>(register_id::rsp);
+    memory_snapshot stack(proc, virt_addr{ rsp });
+    auto found = unwind_all([&](auto pc, auto& regs) {
+        return cfi.unwind(stack, pc, regs);
+        });
+
+    // scratch_ears and pet_cat are inlined into find_happiness
+    REQUIRE(expected.size() == 2);
+    REQUIRE(found == expected);
+    REQUIRE(stack.reads() >= 2 * expected.size());
+    REQUIRE(stack.syscalls() == 1);
+}
+
+TEST_CASE("Stack is unwound lazily", "[unwind]") {
+    auto target = target::launch("targets/step");
+    auto& proc = target->get_process();
+
+    target->create_function_breakpoint("scratch_ears").enable();
+    auto epoch = target->stop_epoch();
+    proc.resume();
+    proc.wait_on_signal();
+    REQUIRE(target->stop_epoch() > epoch);
+
+    auto& stack = target->get_stack();
+    auto top = stack.frames(1);
+    REQUIRE(top.size() == 1);
+    REQUIRE(top[0].pc == proc.get_pc());
+
+    auto all = stack.frames();
+    REQUIRE(all.size() > 2);
+    REQUIRE(all[1].func_die.name().value() == "main");
+    REQUIRE(stack.frames(2).size() == 2);
+    REQUIRE(stack.frames(100).size() == all.size());
+
+    // stopping again throws the old frames away
+    proc.step_instruction();
+    epoch = target->stop_epoch();
+    auto frames = stack.frames();
+    REQUIRE(target->stop_epoch() == epoch);
+    REQUIRE(frames[0].pc == proc.get_pc());
+}
+
+TEST_CASE("Pc lookups are cached per stop", "[target]") {
+    auto target = target::launch("targets/step");
+    auto& proc = target->get_process();
+
+    target->create_function_breakpoint("find_happiness").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto line = target->line_entry_at_pc();
+    auto before = target->location_cache_statistics();
+    REQUIRE(target->line_entry_at_pc() == line);
+    REQUIRE(target->function_at_pc()->name() == "find_happiness");
+    REQUIRE(target->function_name_at_pc() == "step`find_happiness");
+    REQUIRE(target->inline_stack_at_pc().front().name() == "find_happiness");
+    auto after = target->location_cache_statistics();
+    REQUIRE(after.hits == before.hits + 4);
+    REQUIRE(after.misses == before.misses);
+
+    // moving on resolves the new pc once
+    proc.step_instruction();
+    target->line_entry_at_pc();
+    target->line_entry_at_pc();
+    before = after;
+    after = target->location_cache_statistics();
+    REQUIRE(after.misses == before.misses + 1);
+    REQUIRE(after.hits == before.hits + 1);
+
+    // so does writing memory
+    auto pc = proc.get_pc();
+    proc.write_memory(pc, proc.read_memory(pc, 1));
+    target->line_entry_at_pc();
+    REQUIRE(target->location_cache_statistics().misses == after.misses + 1);
+}
+
+TEST_CASE("Deep stacks", "[unwind]") {
+    auto target = target::launch("targets/deep_recursion");
+    auto& proc = target->get_process();
+
+    target->create_function_breakpoint("bottom").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto& stack = target->get_stack();
+    auto summary = stack.summarize_frames(5);
+    REQUIRE(summary.innermost.size() == 5);
+    REQUIRE(summary.innermost[0].func_die.name().value() == "bottom");
+    REQUIRE(summary.innermost[1].func_die.name().value() == "recurse");
+    REQUIRE(summary.outermost.size() == 5);
+    auto outermost = summary.outermost.back().backtrace_report_address;
+    REQUIRE(target->function_name_at_address(outermost) == "deep_recursion`_start");
+    // bottom, main and 10001 calls to recurse, then libc's frames
+    REQUIRE(summary.total > 10003);
+    REQUIRE(summary.total == stack.frames().size());
+
+    // frames only keep what the unwinder changed
+    REQUIRE(sizeof(stack_frame) * 4 < sizeof(registers));
+
+    auto pc = target->get_pc_file_address();
+    auto& cfi = pc.elf_file()->get_dwarf().cfi();
+    auto expected = proc.get_registers();
+    for (auto i = 0; i < 3; ++i) {
+        expected = cfi.unwind(proc, pc, expected);
+        auto rip = expected.read_by_id_as<std::uint64_t>(register_id::rip);
+        pc = virt_addr{ rip - 1 }.to_file_addr(*pc.elf_file());
+        stack.up();
+    }
+
+    auto& regs = stack.regs();
+    for (auto id : { register_id::rip, register_id::rsp, register_id::rbp }) {
+        REQUIRE(regs.read_by_id_as<std::uint64_t>(id) ==
+            expected.read_by_id_as<std::uint64_t>(id));
+    }
+    REQUIRE(stack.current_frame().pc.addr() ==
+        expected.read_by_id_as<std::uint64_t>(register_id::rip));
+}
+
+TEST_CASE("Frame pointer unwinding", "[unwind]") {
+    auto target = target::launch("targets/step");
+    auto& proc = target->get_process();
+
+    target->create_function_breakpoint("scratch_ears").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto rsp = proc.get_registers().read_by_id_as<std::uint64_t>(register_id::rsp);
+    auto regions = proc.get_memory_map();
+    auto stack_region = std::find_if(regions.begin(), regions.end(),
+        [&](auto& region) { return region.contains(virt_addr{ rsp }); });
+    REQUIRE(stack_region != regions.end());
+    REQUIRE(stack_region->writable);
+
+    auto& stack = target->get_stack();
+    auto addresses = stack.frame_pointer_backtrace();
+    REQUIRE(addresses.size() >= 2);
+    REQUIRE(addresses[0] == proc.get_pc());
+
+    auto frames = stack.frames();
+    REQUIRE(addresses[1] == frames[1].pc);
+    REQUIRE(target->function_name_at_address(addresses[1] - 1) == "step`main");
+    REQUIRE(stack.frame_pointer_backtrace(1).size() == 1);
+}
+
+TEST_CASE("Unwinding from a PLT stub", "[unwind]") {
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/marshmallow", dev_null);
+    auto& proc = target->get_process();
+    target->create_function_breakpoint("main").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto& elf = *target->get_pc_file_address().elf_file();
+    auto plt = elf.get_section(".plt").value();
+    auto start = file_addr{ elf, plt->sh_addr };
+    auto end = file_addr{ elf, plt->sh_addr + plt->sh_size };
+    auto in_plt = [&] {
+        auto pc = target->get_pc_file_address();
+        return pc.elf_file() == &elf and pc >= start and pc < end;
+    };
+    for (auto i = 0; i < 1000 and !in_plt(); ++i) proc.step_instruction();
+    REQUIRE(in_plt());
+
+    // the FDE of the PLT entries computes the CFA with an expression,
+    // which depends on where in its 16 byte entry the pc is. the first
+    // entry pushes more before jumping to the dynamic linker
+    while (in_plt()) {
+        auto frames = target->get_stack().frames();
+        REQUIRE(frames.size() > 2);
+        REQUIRE(!frames[0].location.file);
+        REQUIRE(frames[1].func_die.name().value() == "main");
+        proc.step_instruction();
+    }
+    close(dev_null);
+}
+
+TEST_CASE("Stack unwinding benchmark", "[unwind][.][benchmark]") {
+    auto target = target::launch("targets/step");
+    auto& proc = target->get_process();
+
+    target->create_function_breakpoint("scratch_ears").enable();
+    proc.resume();
+    proc.wait_on_signal();
+
+    auto pc = target->get_pc_file_address();
+    auto& cfi = pc.elf_file()->get_dwarf().cfi();
+    auto regs = proc.get_registers();
+    BENCHMARK("call_frame_information::unwind") {
+        return cfi.unwind(proc, pc, regs);
+    };
+
+    auto& stack = target->get_stack();
+    BENCHMARK("stack::unwind") {
+        stack.unwind();
+        return stack.frames().size();
+    };
+    BENCHMARK("stack::frame_pointer_backtrace") {
+        return stack.frame_pointer_backtrace().size();
+    };
+
+    // every saved register of every frame comes out of the one read
+    auto rsp = regs.read_by_id_as<std::uint64_t>(register_id::rsp);
+    memory_snapshot snapshot(proc, virt_addr{ rsp });
+    for (auto frame_pc = pc; frame_pc.elf_file();) {
+        regs = cfi.unwind(snapshot, frame_pc, regs);
+        auto rip = regs.read_by_id_as<std::uint64_t>(register_id::rip);
+        frame_pc = virt_addr{ rip - 1 }.to_file_addr(*pc.elf_file());
+        if (!pc.elf_file()->get_dwarf().function_containing_address(frame_pc)) break;
+    }
+    WARN(snapshot.reads() << " saved register reads took "
+        << snapshot.syscalls() << " syscalls instead of " << snapshot.reads());
 }
 
 TEST_CASE("Shared library tracing works", "[dynlib]") {
@@ -785,13 +1909,56 @@ TEST_CASE("Shared library tracing works", "[dynlib]") {
     proc.resume();
     proc.wait_on_signal();
 
-    REQUIRE(target->get_stack().frames().size() == 2);
+    REQUIRE(target->get_stack().frames().size() > 2);
     REQUIRE(target->get_stack().frames()[0].func_die.name().value() == "libmeow_client_is_cute");
     REQUIRE(target->get_stack().frames()[1].func_die.name().value() == "main");
     REQUIRE(target->get_pc_file_address().elf_file()->path().filename() == "libmeow.so");
     close(dev_null);
 }
 
+TEST_CASE("Attach startup benchmark", "[target][.][benchmark]") {
+    auto proc = process::launch("targets/run_endlessly", false);
+    auto pid = proc->pid();
+
+    // time until the debugger could show its prompt
+    BENCHMARK("target::attach") {
+        return target::attach(pid);
+    };
+}
+
+TEST_CASE("Backtraces of all threads", "[threads]") {
+    auto dev_null = open("/dev/null", O_WRONLY);
+    auto target = target::launch("targets/multi_threaded", dev_null);
+    auto& proc = target->get_process();
+
+    target->create_function_breakpoint("say_hi").enable();
+    proc.resume_all_threads();
+    auto reason = proc.wait_on_signal();
+    REQUIRE(reason.tid != proc.pid());
+
+    auto backtraces = target->backtrace_all_threads();
+    REQUIRE(backtraces.size() >= 2);
+    REQUIRE(std::is_sorted(backtraces.begin(), backtraces.end(),
+        [](auto& lhs, auto& rhs) { return lhs.tid < rhs.tid; }));
+
+    auto hit = std::find_if(backtraces.begin(), backtraces.end(),
+        [&](auto& trace) { return trace.tid == reason.tid; });
+    REQUIRE(hit != backtraces.end());
+    REQUIRE(hit->frames.size() == hit->function_names.size());
+    REQUIRE(hit->function_names[0] == "multi_threaded`say_hi");
+
+    // the same frames a serial unwind finds
+    std::vector<virt_addr> pcs;
+    for (auto& frame : hit->frames) pcs.push_back(frame.pc);
+    auto& stack = target->get_stack(reason.tid);
+    stack.unwind();
+    REQUIRE(pcs.size() == stack.frames().size());
+    for (std::size_t i = 0; i < pcs.size(); ++i) {
+        REQUIRE(pcs[i] == stack.frames()[i].pc);
+    }
+    close(dev_null);
+}
+
 TEST_CASE("Multi-threading works", "[threads]") {
     auto dev_null = open("/dev/null", O_WRONLY);
     auto target = target::launch("targets/multi_threaded", dev_null);
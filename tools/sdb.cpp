@@ -51,13 +51,22 @@ namespace
 
     std::unique_ptr<sdb::target> attach(int argc, const char **argv)
     {   
+        // indexing every object up front costs time and memory for
+        // libraries that are never looked at, so it's opt in
+        sdb::elf_options options;
+        options.index_in_background = std::getenv("SDB_INDEX_IN_BACKGROUND") != nullptr;
+        if (auto cache = std::getenv("SDB_INDEX_CACHE")) {
+            options.index_cache_directory = cache;
+        }
+
         if (argc == 3 && argv[1] == std::string_view("-p")) {
             pid_t pid = std::atoi(argv[2]);
-            return sdb::target::attach(pid);
+            return sdb::target::attach(pid, options);
         }
         else {
             const char* program_path = argv[1];
-            auto target = sdb::target::launch(program_path);
+            auto target = sdb::target::launch(
+                program_path, std::nullopt, options);
             fmt::print("Launched process with PID {}\n", target->get_process().pid());
             return target;
         }
@@ -150,7 +159,7 @@ namespace
             message += fmt::format(", {}:{}", file, line->line);
         }
 
-        auto func_name = target.function_name_at_address(pc);
+        auto func_name = target.function_name_at_pc(reason.tid);
         if (func_name != "") {
             message += fmt::format(" ({})", func_name);
         }
@@ -191,6 +200,9 @@ namespace
                 register    - Commands for operating on registers
                 disassemble - Disassemble machine code into assembly
                 down        - Select the stack frame below the current one
+                backtrace   - Print the call stack, -fp follows frame pointers only,
+                              <n> prints only the first and last n frames,
+                              all prints the stacks of every stopped thread
                 up          - Select the stack frame above the current one
                 step        - Step over a single instruction
                 watchpoint  - Command for operating on watchpoints
@@ -313,20 +325,66 @@ namespace
         }
     }
 
+    void print_stack_frame(
+        const sdb::target& target, const sdb::stack_frame& frame, std::size_t i) {
+        auto pc = frame.backtrace_report_address;
+        auto func_name = target.function_name_at_address(pc);
+        std::string message = i == target.get_stack().current_frame_index() ? "*" : " ";
+        message += fmt::format("[{}]: {:#x} {}", i, pc.addr(), func_name);
+        
+        if (frame.inlined) {
+            message += fmt::format(" [inlined] {}", *frame.func_die.name());
+        }
+
+        fmt::print("{}\n", message);
+    }
+
     void print_backtrace(const sdb::target& target) {
-        auto& stack = target.get_stack();
         auto i = 0;
-        for (auto& frame : stack.frames()) {
-            auto pc = frame.backtrace_report_address;
-            auto func_name = target.function_name_at_address(pc);
-            std::string message = i == stack.current_frame_index() ? "*" : " ";
-            message += fmt::format("[{}]: {:#x} {}", i++, pc.addr(), func_name);
-            
-            if (frame.inlined) {
-                message += fmt::format(" [inlined] {}", *frame.func_die.name());
+        for (auto& frame : target.get_stack().frames()) {
+            print_stack_frame(target, frame, i++);
+        }
+    }
+
+    // first and last n frames only, for very deep stacks
+    void print_backtrace(const sdb::target& target, std::size_t n) {
+        auto summary = target.get_stack().summarize_frames(n);
+        std::size_t i = 0;
+        for (auto& frame : summary.innermost) {
+            print_stack_frame(target, frame, i++);
+        }
+
+        auto first_outer = summary.total - summary.outermost.size();
+        if (first_outer > i) {
+            fmt::print(" ... {} more frames ...\n", first_outer - i);
+        }
+        i = first_outer;
+        for (auto& frame : summary.outermost) {
+            print_stack_frame(target, frame, i++);
+        }
+    }
+
+    void print_all_backtraces(const sdb::target& target) {
+        for (auto& trace : target.backtrace_all_threads()) {
+            fmt::print("Thread {}:\n", trace.tid);
+            for (std::size_t i = 0; i < trace.frames.size(); ++i) {
+                auto& frame = trace.frames[i];
+                auto message = fmt::format(" [{}]: {:#x} {}",
+                    i, frame.backtrace_report_address.addr(), trace.function_names[i]);
+                if (frame.inlined) {
+                    message += fmt::format(" [inlined] {}", *frame.func_die.name());
+                }
+                fmt::print("{}\n", message);
             }
+        }
+    }
 
-            fmt::print("{}\n", message);
+    void print_frame_pointer_backtrace(const sdb::target& target) {
+        auto i = 0;
+        for (auto pc : target.get_stack().frame_pointer_backtrace()) {
+            // return addresses point just past the call
+            auto func_name = target.function_name_at_address(i == 0 ? pc : pc - 1);
+            fmt::print(" [{}]: {:#x} {}\n", i++, pc.addr(), func_name);
         }
     }
 
@@ -647,10 +705,15 @@ namespace
     }
 
     void print_code_location(sdb::target& target) {
-        if (target.get_stack().has_frames()) {
-			auto& frame = target.get_stack().current_frame();
+        auto& stack = target.get_stack();
+        if (stack.has_frames() and stack.current_frame().location.file) {
+			auto& frame = stack.current_frame();
 			print_source(frame.location.file->path, frame.location.line, 3);
 		}
+		else if (stack.has_frames()) {
+			auto pc = stack.current_frame().backtrace_report_address;
+			print_disassembly(target.get_process(), pc, 5);
+		}
 		else {
 			print_disassembly(target.get_process(), target.get_process().get_pc(), 5);
 		}
@@ -919,7 +982,23 @@ namespace
             print_code_location(*target);
         }
         else if (is_prefix(command, "backtrace")) {
-            print_backtrace(*target);
+            if (args.size() > 1 and args[1] == "-fp") {
+                print_frame_pointer_backtrace(*target);
+            }
+            else if (args.size() > 1 and args[1] == "all") {
+                print_all_backtraces(*target);
+            }
+            else if (args.size() > 1) {
+                auto n = sdb::to_integral<std::size_t>(args[1]);
+                if (!n) {
+                    std::cerr << "Invalid frame count\n";
+                    return;
+                }
+                print_backtrace(*target, *n);
+            }
+            else {
+                print_backtrace(*target);
+            }
         }
         else if (is_prefix(command, "watchpoint")) {
             handle_watchpoint_command(*process, args);